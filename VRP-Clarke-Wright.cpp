@@ -6,9 +6,40 @@
 #include <cmath>
 #include <limits>
 #include <algorithm>
-#include <set>
 #include <chrono>
 #include <random>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <functional>
+#include <tuple>
+#include <condition_variable>
+#include <memory>
+#include <climits>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define VRP_HAS_SOCKETS 1
+#endif
+
+using Clock = std::chrono::steady_clock;
 
 // --- Data Structure ---
 struct Customer {
@@ -16,19 +47,65 @@ struct Customer {
     double x, y;
 };
 
+// Node ids stored in routes; define VRP_SMALL_IDS for instances with fewer than 65536 nodes
+#ifdef VRP_SMALL_IDS
+using NodeId = uint16_t;
+#else
+using NodeId = uint32_t;
+#endif
+
 struct Vehicle {
     int id;
     int capacity;
+    double fixedCost = 0.0;       // paid once if the vehicle is used
+    double costPerDistance = 1.0; // paid per unit of distance driven
+};
+
+// Summary of a node sequence that lets a move's new route be evaluated by concatenating
+// O(1) pieces (Vidal et al.'s time-warp formulation). earliest/latest bound the start of
+// service at the first node such that the sequence incurs only timeWarp lateness.
+struct RouteSegment {
+    int first = 0, last = 0;
+    double distance = 0.0;
+    int load = 0;
+    double duration = 0.0; // travel, service and waiting time
+    double timeWarp = 0.0;
+    double earliest = 0.0, latest = std::numeric_limits<double>::infinity();
+
+    // Segment a followed by segment b, travel is the time from a.last to b.first
+    static RouteSegment concat(const RouteSegment& a, const RouteSegment& b, double travel) {
+        RouteSegment r;
+        double delta = a.duration - a.timeWarp + travel;
+        double wait = std::max(b.earliest - delta - a.latest, 0.0);
+        double warp = std::max(a.earliest + delta - b.latest, 0.0);
+        r.first = a.first;
+        r.last = b.last;
+        r.distance = a.distance + travel + b.distance;
+        r.load = a.load + b.load;
+        r.duration = a.duration + b.duration + travel + wait;
+        r.timeWarp = a.timeWarp + b.timeWarp + warp;
+        r.earliest = std::max(b.earliest - delta, a.earliest) - wait;
+        r.latest = std::min(b.latest - delta, a.latest) + warp;
+        return r;
+    }
 };
 
 class Route {
 public:
     int vehicleId;
-    std::vector<Customer> customers;
+    std::vector<NodeId> customers; // customer ids in visiting order, coordinates live in ProblemData
     double totalDistance;
     int currentLoad;
+    // Routes with the same nonzero version hold the same vehicle and sequence, so copies
+    // can skip them. Code that edits a route in place resets it to 0 (unknown).
+    uint64_t version = 0;
 
     Route(int vId = -1) : vehicleId(vId), totalDistance(0.0), currentLoad(0) {}
+
+    static uint64_t newVersion() {
+        static std::atomic<uint64_t> counter{0};
+        return ++counter;
+    }
 };
 
 class ProblemData {
@@ -37,6 +114,22 @@ public:
     std::vector<Customer> customers;
     std::vector<Vehicle> vehicles;
     std::vector<std::vector<double>> distanceMatrix;
+    std::vector<double> coordX, coordY; // customer coordinates as arrays, same order as customers
+    std::vector<int> demands;           // by node id, the depot has demand 0
+
+    // Vehicles grouped by equal capacity and costs, largest capacity first
+    struct VehicleType {
+        int capacity;
+        double fixedCost, costPerDistance;
+        std::vector<int> ids;
+    };
+    std::vector<VehicleType> fleetTypes;
+    // Capacity levels for Hall's condition on the nested vehicle sets: the distinct capacities,
+    // largest first, and how many vehicles have at least each. Routes can each get a vehicle
+    // of their own iff at every level the routes too heavy for the next smaller capacity (all
+    // routes, at the smallest level) are no more than the vehicles of that level.
+    std::vector<int> levelCapacity, levelVehicles;
+    mutable std::atomic<int> metric{-1}; // cached isMetric(), -1 until computed
 
     ProblemData() : depot({0, 0.0, 0.0}) {}
 
@@ -49,6 +142,7 @@ public:
 
         std::string line;
         int currentId = 0;
+        demands.assign(1, 0);
 
         // Read the first line as the depot
         if (std::getline(coordsFile, line)) {
@@ -69,11 +163,22 @@ public:
             double x, y;
             if (ss >> x >> y) {
                 customers.push_back({currentId++, x, y}); // Customers will have IDs starting from 1
+                std::string token;
+                int q = 1; // optional third column, one stop by default
+                if (ss >> token && !parseInt(token, q)) throw std::runtime_error("Wrong demand at Coord.txt: " + line);
+                if (ss >> token) throw std::runtime_error("Unexpected column at Coord.txt: " + line);
+                demands.push_back(q);
             } else {
                 std::cerr << "Warning: Wrong Format Line at Coord.txt: " << line << std::endl;
             }
         }
         coordsFile.close();
+#ifdef VRP_SMALL_IDS
+        if (customers.size() > std::numeric_limits<NodeId>::max())
+            throw std::runtime_error("Too many customers for VRP_SMALL_IDS");
+#endif
+        coordX.clear(); coordY.clear();
+        for (const auto& c : customers) { coordX.push_back(c.x); coordY.push_back(c.y); }
 
         // Verify if the number of customers is as expected
         if (customers.size() != 199) {
@@ -91,6 +196,7 @@ public:
         }
 
         distanceMatrix.clear(); // Clear previous data
+        metric = -1;
         int rowCount = 0;
         while (std::getline(distFile, line)) {
             std::stringstream ss(line);
@@ -118,19 +224,716 @@ public:
         for (int i = 0; i < numVehicles; ++i) {
             vehicles.push_back({i, vehicleCapacity});
         }
+        buildFleetTypes();
+    }
+
+    // Replace the fleet with one vehicle type per line: "count capacity [fixedCost [costPerDistance]]"
+    void loadFleet(const std::string& fleetFilePath) {
+        std::ifstream file(fleetFilePath);
+        if (!file.is_open()) throw std::runtime_error("Program wasn't able to open " + fleetFilePath);
+        std::vector<Vehicle> fleet;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::stringstream ss(line);
+            int count;
+            Vehicle v{0, 0};
+            if (!(ss >> count)) continue;
+            if (!(ss >> v.capacity) || count < 0 || v.capacity <= 0)
+                throw std::runtime_error("Wrong vehicle type in " + fleetFilePath + ": " + line);
+            if (ss >> v.fixedCost) ss >> v.costPerDistance;
+            for (int i = 0; i < count; ++i) { v.id = fleet.size(); fleet.push_back(v); }
+        }
+        if (fleet.empty()) throw std::runtime_error(fleetFilePath + " has no vehicles");
+        vehicles.swap(fleet);
+        buildFleetTypes();
+    }
+
+    void buildFleetTypes() {
+        std::vector<int> order(vehicles.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        auto key = [&](int i) { return std::make_tuple(-vehicles[i].capacity, vehicles[i].fixedCost, vehicles[i].costPerDistance); };
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return key(a) < key(b); });
+        fleetTypes.clear();
+        for (int i : order) {
+            if (fleetTypes.empty() || key(fleetTypes.back().ids.front()) != key(i))
+                fleetTypes.push_back({vehicles[i].capacity, vehicles[i].fixedCost, vehicles[i].costPerDistance, {}});
+            fleetTypes.back().ids.push_back(i);
+        }
+        levelCapacity.clear();
+        levelVehicles.clear();
+        for (const auto& t : fleetTypes) {
+            if (levelCapacity.empty() || levelCapacity.back() != t.capacity) {
+                levelCapacity.push_back(t.capacity);
+                levelVehicles.push_back(levelVehicles.empty() ? 0 : levelVehicles.back());
+            }
+            levelVehicles.back() += t.ids.size();
+        }
+    }
+
+    int maxCapacity() const { return fleetTypes.empty() ? 0 : fleetTypes.front().capacity; }
+
+    // Whether a route of this load counts against capacity level k
+    bool heavyAt(int load, size_t k) const { return k + 1 == levelCapacity.size() || load > levelCapacity[k + 1]; }
+
+    // Add sign times one route of this load to per-level route counts
+    void addToLevels(std::vector<int>& counts, int load, int sign = 1) const {
+        for (size_t k = 0; k < levelCapacity.size(); ++k) counts[k] += sign * heavyAt(load, k);
+    }
+
+    bool levelsFit(const std::vector<int>& counts) const {
+        for (size_t k = 0; k < counts.size(); ++k)
+            if (counts[k] > levelVehicles[k]) return false;
+        return true;
+    }
+
+    // True when all vehicles share one capacity, which Split and Sweep cut routes at
+    bool uniformCapacity() const {
+        return fleetTypes.empty() || fleetTypes.front().capacity == fleetTypes.back().capacity;
+    }
+
+    // Replace the demands with one value per customer line ("demand" or "id demand")
+    void loadDemands(const std::string& demandFilePath) {
+        std::ifstream file(demandFilePath);
+        if (!file.is_open()) throw std::runtime_error("Program wasn't able to open " + demandFilePath);
+        std::string line;
+        int next = 1;
+        while (std::getline(file, line)) {
+            std::stringstream ss(line);
+            std::vector<std::string> tokens;
+            for (std::string token; ss >> token;) tokens.push_back(token);
+            if (tokens.empty()) continue;
+            int id = next, q = 0;
+            bool ok = false;
+            if (tokens.size() == 1) ok = parseInt(tokens[0], q);                                  // "demand"
+            else if (tokens.size() == 2) ok = parseInt(tokens[0], id) && parseInt(tokens[1], q); // "id demand"
+            if (!ok) throw std::runtime_error("Wrong format in " + demandFilePath + ": " + line);
+            if (id < 1 || id > (int)customers.size())
+                throw std::runtime_error("Customer id out of range in " + demandFilePath + ": " + line);
+            demands[id] = q;
+            next = id + 1;
+        }
+    }
+
+    // Whole-token integer parse: "3" is accepted, "3.5", "x" and "3x" are not
+    static bool parseInt(const std::string& token, int& value) {
+        char* end = nullptr;
+        errno = 0;
+        long v = std::strtol(token.c_str(), &end, 10);
+        if (end == token.c_str() || *end != '\0' || errno == ERANGE || v < INT_MIN || v > INT_MAX) return false;
+        value = (int)v;
+        return true;
+    }
+
+    // Every customer must fit in the largest vehicle on its own. Checked once the fleet and
+    // the demands are final, since Fleet.txt may replace the default vehicles.
+    void checkDemands() const {
+        int capacity = maxCapacity();
+        for (size_t id = 1; id < demands.size(); ++id) {
+            if (demands[id] < 0) throw std::runtime_error("Negative demand for customer " + std::to_string(id));
+            if (!vehicles.empty() && demands[id] > capacity)
+                throw std::runtime_error("Demand of customer " + std::to_string(id) + " exceeds every vehicle capacity");
+        }
     }
 
     // Get the distance between two nodes (depot or customers)
     double getDistance(int fromId, int toId) const {
         return distanceMatrix[fromId][toId];
     }
+
+    // Whether min(d(i,j), d(j,i)) satisfies the triangle inequality. The O(n^3) check
+    // runs once per loaded matrix; concurrent first calls compute the same answer.
+    bool isMetric() const {
+        int known = metric.load(std::memory_order_relaxed);
+        if (known >= 0) return known;
+        auto edge = [&](int i, int j) { return std::min(getDistance(i, j), getDistance(j, i)); };
+        int nodes = customers.size() + 1;
+        bool ok = true;
+        for (int k = 0; k < nodes && ok; ++k)
+            for (int i = 0; i < nodes && ok; ++i)
+                for (int j = 0; j < nodes; ++j)
+                    if (edge(i, j) > edge(i, k) + edge(k, j) + 1e-9) { ok = false; break; }
+        metric.store(ok, std::memory_order_relaxed);
+        return ok;
+    }
+
+    // Load a customer adds to its route
+    int demand(int id) const { return demands[id]; }
+
+    // Service time and time window of a node; the instance has none, so routes are never late
+    double serviceTime(int /*id*/) const { return 0.0; }
+    double readyTime(int /*id*/) const { return 0.0; }
+    double dueTime(int /*id*/) const { return std::numeric_limits<double>::infinity(); }
+    double maxRouteDuration = std::numeric_limits<double>::infinity();
+
+    RouteSegment segment(int id) const {
+        RouteSegment s;
+        s.first = s.last = id;
+        s.load = id == depot.id ? 0 : demand(id);
+        s.duration = serviceTime(id);
+        s.earliest = readyTime(id);
+        s.latest = dueTime(id);
+        return s;
+    }
+
+    RouteSegment join(const RouteSegment& a, const RouteSegment& b) const {
+        return RouteSegment::concat(a, b, getDistance(a.last, b.first));
+    }
+
+    bool feasible(const RouteSegment& s, int capacity) const {
+        return s.load <= capacity && s.timeWarp <= 1e-9 && s.duration <= maxRouteDuration;
+    }
+
+    // Get a node by id (0 is the depot, customers are stored by id - 1)
+    const Customer& node(int id) const {
+        return id == 0 ? depot : customers[id - 1];
+    }
+};
+
+// Distance of a customer sequence that starts and ends at the depot
+double routeDistance(const ProblemData& data, const std::vector<NodeId>& seq) {
+    if (seq.empty()) return 0.0;
+    double d = data.getDistance(data.depot.id, seq.front());
+    for (size_t i = 0; i + 1 < seq.size(); ++i)
+        d += data.getDistance(seq[i], seq[i + 1]);
+    return d + data.getDistance(seq.back(), data.depot.id);
+}
+
+// Summary of a whole route in O(length)
+RouteSegment routeSegment(const ProblemData& data, const Route& route) {
+    RouteSegment s = data.segment(data.depot.id);
+    for (NodeId id : route.customers) s = data.join(s, data.segment(id));
+    return data.join(s, data.segment(data.depot.id));
+}
+
+// Prefix and suffix segments of the routes a search works on. They live here rather than
+// in Route, so copying a Solution copies only customer sequences. prefix[r][k] covers the
+// depot and the first k customers of route r, suffix[r][k] customers k.. and the depot.
+// A route is rebuilt in O(length) on its first query after touch(r) or reset(); as a
+// guard it is also rebuilt when its length or load no longer match.
+class RouteSegments {
+public:
+    // Forget every route, e.g. after routes were added, dropped or reordered
+    void reset() { std::fill(stale.begin(), stale.end(), 1); }
+
+    // Route r changed
+    void touch(size_t r) { if (r < stale.size()) stale[r] = 1; }
+
+    // Summary of route r after inserting id before position pos
+    RouteSegment withInsertion(const ProblemData& data, size_t r, const Route& route, size_t pos, int id) {
+        sync(data, r, route);
+        return data.join(data.join(prefix[r][pos], data.segment(id)), suffix[r][pos]);
+    }
+
+    // Summary of route r after replacing the customer at pos with id
+    RouteSegment withReplacement(const ProblemData& data, size_t r, const Route& route, size_t pos, int id) {
+        sync(data, r, route);
+        return data.join(data.join(prefix[r][pos], data.segment(id)), suffix[r][pos + 1]);
+    }
+
+private:
+    std::vector<std::vector<RouteSegment>> prefix, suffix;
+    std::vector<char> stale;
+
+    void sync(const ProblemData& data, size_t r, const Route& route) {
+        if (r >= stale.size()) {
+            stale.resize(r + 1, 1);
+            prefix.resize(r + 1);
+            suffix.resize(r + 1);
+        }
+        size_t n = route.customers.size();
+        if (!stale[r] && prefix[r].size() == n + 1 && suffix[r][0].load == route.currentLoad) {
+#ifdef VRP_CHECK_COSTS
+            // A route changed without touch() would keep summaries of its old sequence
+            RouteSegment whole = routeSegment(data, route), kept = data.join(prefix[r][n], suffix[r][n]);
+            if (std::fabs(whole.distance - kept.distance) > 1e-6 * std::max(1.0, whole.distance))
+                throw std::runtime_error("Route segments used after an untouched change");
+#endif
+            return;
+        }
+        stale[r] = 0;
+        auto& pre = prefix[r];
+        auto& suf = suffix[r];
+        pre.resize(n + 1);
+        suf.resize(n + 1);
+        pre[0] = data.segment(data.depot.id);
+        for (size_t k = 0; k < n; ++k) pre[k + 1] = data.join(pre[k], data.segment(route.customers[k]));
+        suf[n] = data.segment(data.depot.id);
+        for (size_t k = n; k-- > 0;) suf[k] = data.join(data.segment(route.customers[k]), suf[k + 1]);
+    }
+};
+
+// --- Solver Arena ---
+// Monotonic arena for per-solve scratch containers (std::pmr). reset() releases
+// everything at once and keeps the buffer, so multi-start and batch solves reuse the
+// same memory; reset(minBytes) grows the buffer first when a solve needs more. It backs
+// the Clarke-Wright savings list, the one large scratch container; route buffers are
+// plain vectors recycled through each Solution's spare pool instead.
+class SolverArena {
+public:
+    explicit SolverArena(size_t bytes = 1 << 20) { allocate(bytes); }
+
+    std::pmr::memory_resource* resource() { return arena.get(); }
+    size_t capacity() const { return buffer.size(); }
+
+    void reset(size_t minBytes = 0) {
+        if (minBytes > buffer.size()) allocate(minBytes);
+        else arena->release();
+    }
+
+private:
+    std::vector<std::byte> buffer;
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+
+    void allocate(size_t bytes) {
+        arena.reset();
+        buffer.assign(bytes, std::byte{0});
+        arena = std::make_unique<std::pmr::monotonic_buffer_resource>(buffer.data(), buffer.size(),
+                                                                       std::pmr::new_delete_resource());
+    }
+};
+
+// --- Work-Stealing Thread Pool ---
+// Each worker owns a deque: it pops its own tasks from the back and steals from
+// the front of the other workers' deques when it runs dry. Callers wait for their
+// own TaskGroup, so tasks left running by someone else (a portfolio constructor past
+// its deadline) do not hold them up. wait() must not be called from inside a task.
+class ThreadPool {
+public:
+    struct TaskGroup { size_t pending = 0; }; // guarded by the pool mutex
+
+
+    explicit ThreadPool(size_t numThreads = std::max(1u, std::thread::hardware_concurrency())) {
+        for (size_t i = 0; i < numThreads; ++i) queues.push_back(std::make_unique<WorkQueue>());
+        for (size_t i = 0; i < numThreads; ++i) threads.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~ThreadPool() {
+        { std::lock_guard<std::mutex> lock(m); stop = true; }
+        wakeCv.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    size_t size() const { return threads.size(); }
+
+    // Queue a task, counted in group if one is given; tasks are spread round-robin over the
+    // worker deques
+    void submit(std::function<void()> task, TaskGroup* group = nullptr) {
+        size_t q = nextQueue++ % queues.size();
+        if (group) { std::lock_guard<std::mutex> lock(m); ++group->pending; }
+        {
+            std::lock_guard<std::mutex> lock(queues[q]->m);
+            queues[q]->tasks.push_back({std::move(task), group});
+        }
+        { std::lock_guard<std::mutex> lock(m); ++queued; }
+        wakeCv.notify_one();
+    }
+
+    // Block until every task submitted with group has finished
+    void wait(TaskGroup& group) {
+        std::unique_lock<std::mutex> lock(m);
+        doneCv.wait(lock, [&group] { return group.pending == 0; });
+    }
+
+private:
+    struct Task { std::function<void()> run; TaskGroup* group; };
+    struct WorkQueue { std::mutex m; std::deque<Task> tasks; };
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex m;
+    std::condition_variable wakeCv, doneCv;
+    size_t queued = 0;
+    std::atomic<size_t> nextQueue{0};
+    bool stop = false;
+
+    bool tryPop(size_t self, Task& task) {
+        for (size_t k = 0; k < queues.size(); ++k) {
+            WorkQueue& q = *queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(q.m);
+            if (q.tasks.empty()) continue;
+            if (k == 0) { task = std::move(q.tasks.back()); q.tasks.pop_back(); }
+            else { task = std::move(q.tasks.front()); q.tasks.pop_front(); }
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(size_t self) {
+        Task task;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                wakeCv.wait(lock, [this] { return stop || queued > 0; });
+                if (stop && queued == 0) return;
+                --queued;
+            }
+            // A queued task exists somewhere; keep looking until we get one
+            while (!tryPop(self, task)) std::this_thread::yield();
+            task.run();
+            task.run = nullptr;
+            if (task.group) {
+                // Notify under the lock: the waiter may destroy the group as soon as it wakes
+                std::lock_guard<std::mutex> lock(m);
+                if (--task.group->pending == 0) doneCv.notify_all();
+            }
+        }
+    }
+};
+
+// --- Two-Level Doubly-Linked Tour ---
+// Cyclic tour over local nodes 0..n-1 where node 0 (the depot) always comes first.
+// Nodes are grouped in segments of about sqrt(n) that carry a reversal bit, so
+// next/prev/before are O(1) and reversing a path costs O(sqrt(n)) instead of O(n).
+class TwoLevelTour {
+public:
+    // Build from a visiting order; order[0] must be node 0
+    void build(const std::vector<int>& order) {
+        int n = order.size();
+        groupSize = std::max(4, (int)std::sqrt((double)n));
+        maxSegs = 2 * (n / groupSize + 1) + 2;
+        nodes.assign(n, Node{});
+        segs.clear();
+        segs.reserve(maxSegs + 4);
+        for (int k = 0; k < n; ++k) {
+            if (k % groupSize == 0) segs.push_back({false, order[k], order[k], (int)segs.size(), 0, 0});
+            Seg& sg = segs.back();
+            Node& nd = nodes[order[k]];
+            nd.seg = segs.size() - 1;
+            nd.seq = k % groupSize;
+            nd.prev = nd.seq == 0 ? -1 : order[k - 1];
+            nd.next = -1;
+            if (nd.prev != -1) nodes[nd.prev].next = order[k];
+            sg.last = order[k];
+        }
+        int m = segs.size();
+        for (int k = 0; k < m; ++k) { segs[k].prev = (k + m - 1) % m; segs[k].next = (k + 1) % m; }
+    }
+
+    int next(int a) const {
+        const Seg& sg = segs[nodes[a].seg];
+        int b = sg.rev ? nodes[a].prev : nodes[a].next;
+        return b != -1 ? b : head(segs[sg.next]);
+    }
+
+    int prev(int a) const {
+        const Seg& sg = segs[nodes[a].seg];
+        int b = sg.rev ? nodes[a].next : nodes[a].prev;
+        return b != -1 ? b : tail(segs[sg.prev]);
+    }
+
+    // True if a is visited before b when walking from the depot
+    bool before(int a, int b) const {
+        const Seg &sa = segs[nodes[a].seg], &sb = segs[nodes[b].seg];
+        if (sa.rank != sb.rank) return sa.rank < sb.rank;
+        return sa.rev ? nodes[a].seq > nodes[b].seq : nodes[a].seq < nodes[b].seq;
+    }
+
+    // Reverse the path a..b; a must come before b and the path must not hold the depot
+    void reverse(int a, int b) {
+        if (a == b) return;
+        if (nodes[a].seg == nodes[b].seg && before(a, b)) { reverseInside(a, b); return; }
+        if ((int)segs.size() > maxSegs) rebuild();
+        splitBefore(a);
+        splitBefore(next(b));
+        int sa = nodes[a].seg, sb = nodes[b].seg;
+        int p = segs[sa].prev, q = segs[sb].next, rank = segs[sa].rank;
+        for (int k = sa;; k = segs[k].prev) { // segs[k].prev is the old next after the swap
+            std::swap(segs[k].prev, segs[k].next);
+            segs[k].rev = !segs[k].rev;
+            if (k == sb) break;
+        }
+        segs[sb].prev = p; segs[p].next = sb;
+        segs[sa].next = q; segs[q].prev = sa;
+        for (int k = sb;; k = segs[k].next) {
+            segs[k].rank = rank++;
+            if (k == sa) break;
+        }
+    }
+
+    // Visit nodes in tour order starting at the depot
+    template <class F> void forEach(F f) const {
+        int a = 0;
+        do { f(a); a = next(a); } while (a != 0);
+    }
+
+private:
+    struct Seg { bool rev; int first, last, rank, prev, next; };
+    struct Node { int seg = 0, seq = 0, next = -1, prev = -1; };
+    std::vector<Node> nodes;
+    std::vector<Seg> segs;
+    std::vector<int> scratch;
+    int groupSize = 4, maxSegs = 4;
+
+    int head(const Seg& sg) const { return sg.rev ? sg.last : sg.first; }
+    int tail(const Seg& sg) const { return sg.rev ? sg.first : sg.last; }
+
+    void rebuild() {
+        std::vector<int> order;
+        order.swap(scratch);
+        order.clear();
+        forEach([&](int a) { order.push_back(a); });
+        build(order);
+        scratch.swap(order);
+    }
+
+    // Make a the first node (in tour direction) of its segment
+    void splitBefore(int a) {
+        int s = nodes[a].seg;
+        if (head(segs[s]) == a) return;
+        Seg moved{segs[s].rev, 0, 0, 0, 0, 0};
+        // The moved part is the un-reversed range a..last, or first..a when reversed
+        if (!segs[s].rev) {
+            moved.first = a; moved.last = segs[s].last;
+            segs[s].last = nodes[a].prev;
+            nodes[nodes[a].prev].next = -1; nodes[a].prev = -1;
+        } else {
+            moved.first = segs[s].first; moved.last = a;
+            segs[s].first = nodes[a].next;
+            nodes[nodes[a].next].prev = -1; nodes[a].next = -1;
+        }
+        int t = segs.size();
+        for (int k = moved.first; k != -1; k = nodes[k].next) nodes[k].seg = t;
+        moved.prev = s;
+        moved.next = segs[s].next;
+        moved.rank = segs[s].rank + 1;
+        for (int k = segs[s].next; segs[k].rank != 0; k = segs[k].next) ++segs[k].rank;
+        segs.push_back(moved);
+        segs[moved.next].prev = t;
+        segs[s].next = t;
+    }
+
+    // Reverse a..b inside one segment by relinking the nodes in place
+    void reverseInside(int a, int b) {
+        int s = nodes[a].seg;
+        int x = segs[s].rev ? b : a, y = segs[s].rev ? a : b; // un-reversed x..y
+        scratch.clear();
+        for (int k = x;; k = nodes[k].next) { scratch.push_back(k); if (k == y) break; }
+        int p = nodes[x].prev, q = nodes[y].next, seq = nodes[x].seq;
+        std::reverse(scratch.begin(), scratch.end());
+        for (size_t k = 0; k < scratch.size(); ++k) {
+            Node& nd = nodes[scratch[k]];
+            nd.seq = seq + k;
+            nd.prev = k == 0 ? p : scratch[k - 1];
+            nd.next = k + 1 == scratch.size() ? q : scratch[k + 1];
+        }
+        if (p != -1) nodes[p].next = scratch.front(); else segs[s].first = scratch.front();
+        if (q != -1) nodes[q].prev = scratch.back(); else segs[s].last = scratch.back();
+    }
+};
+
+// --- Route Cost Cache ---
+// Memoizes the best sequence found so far for a set of customers. The key is an
+// order-independent 64-bit signature; entries also keep the sorted ids so a hash
+// collision is never mistaken for a hit. Sharded mutexes, LRU eviction per shard.
+class RouteCostCache {
+public:
+    explicit RouteCostCache(size_t capacity = 4096, size_t numShards = 16)
+        : shards(numShards), shardCapacity(std::max<size_t>(1, capacity / numShards)) {}
+
+    static uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    // Sum of mixed ids: independent of the visiting order
+    static uint64_t signature(const std::vector<NodeId>& seq) {
+        uint64_t h = 0;
+        for (NodeId c : seq) h += mix(c);
+        return h;
+    }
+
+    // Returns true and the cached sequence/cost if this customer set is known
+    bool lookup(const std::vector<NodeId>& seq, std::vector<int>& bestSeq, double& cost) {
+        uint64_t sig = signature(seq);
+        const std::vector<int>& key = sortedKey(seq);
+        Shard& sh = shards[sig % shards.size()];
+        std::lock_guard<std::mutex> lock(sh.m);
+        auto it = sh.index.find(sig);
+        if (it == sh.index.end() || it->second->key != key) { ++missCount; return false; }
+        sh.lru.splice(sh.lru.begin(), sh.lru, it->second);
+        bestSeq = it->second->sequence;
+        cost = it->second->cost;
+        ++hitCount;
+        return true;
+    }
+
+    // Records a sequence for its customer set, keeping the cheaper one
+    void store(const std::vector<NodeId>& seq, double cost) {
+        uint64_t sig = signature(seq);
+        const std::vector<int>& key = sortedKey(seq);
+        Shard& sh = shards[sig % shards.size()];
+        std::lock_guard<std::mutex> lock(sh.m);
+        auto it = sh.index.find(sig);
+        if (it != sh.index.end()) {
+            Entry& e = *it->second;
+            sh.lru.splice(sh.lru.begin(), sh.lru, it->second);
+            if (e.key == key && e.cost <= cost) return;
+            e.key = key; e.cost = cost;
+            e.sequence.clear();
+            for (NodeId c : seq) e.sequence.push_back(c);
+            return;
+        }
+        if (sh.lru.size() >= shardCapacity) {
+            sh.index.erase(sh.lru.back().sig);
+            sh.lru.pop_back();
+        }
+        Entry e{sig, key, {}, cost};
+        for (NodeId c : seq) e.sequence.push_back(c);
+        sh.lru.push_front(std::move(e));
+        sh.index[sig] = sh.lru.begin();
+    }
+
+    uint64_t hits() const { return hitCount; }
+    uint64_t misses() const { return missCount; }
+    double hitRate() const {
+        uint64_t total = hitCount + missCount;
+        return total ? (double)hitCount / total : 0.0;
+    }
+
+private:
+    struct Entry { uint64_t sig; std::vector<int> key; std::vector<int> sequence; double cost; };
+    struct Shard {
+        std::mutex m;
+        std::list<Entry> lru;
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    };
+    std::vector<Shard> shards;
+    size_t shardCapacity;
+    std::atomic<uint64_t> hitCount{0}, missCount{0};
+
+    static const std::vector<int>& sortedKey(const std::vector<NodeId>& seq) {
+        thread_local std::vector<int> key;
+        key.clear();
+        for (NodeId c : seq) key.push_back(c);
+        std::sort(key.begin(), key.end());
+        return key;
+    }
 };
 
 // --- Clarke-Wright Savings Algorithm ---
+// Emptied routes kept for their buffers. The pool is scratch, not part of a solution's
+// value, so copying a Solution leaves each side's pool where it was.
+struct SpareRoutes {
+    std::vector<Route> routes;
+    SpareRoutes() = default;
+    SpareRoutes(const SpareRoutes&) {}
+    SpareRoutes& operator=(const SpareRoutes&) { return *this; }
+};
+
 class Solution {
 public:
     std::vector<Route> routes;
     double totalCost = 0.0;
+    // Zobrist-style hash of the undirected edge multiset: the wrapping sum of one random
+    // key per edge, so moves update it in O(1) and route order or direction do not matter
+    uint64_t fingerprint = 0;
+    SpareRoutes spare;
+
+    static uint64_t edgeKey(int a, int b) {
+        if (a == b) return 0; // the depot-depot "edge" of an empty route
+        if (a > b) std::swap(a, b);
+        return RouteCostCache::mix((uint64_t(a) << 32) | uint32_t(b));
+    }
+
+    static uint64_t routeFingerprint(const Route& r) {
+        if (r.customers.empty()) return 0;
+        uint64_t h = edgeKey(0, r.customers.front()) + edgeKey(r.customers.back(), 0);
+        for (size_t k = 0; k + 1 < r.customers.size(); ++k) h += edgeKey(r.customers[k], r.customers[k + 1]);
+        return h;
+    }
+
+    void computeFingerprint() {
+        fingerprint = 0;
+        for (const auto& r : routes) fingerprint += routeFingerprint(r);
+    }
+
+    // Successor and predecessor of every customer by id, 0 standing for the depot
+    void neighbours(const ProblemData& data, std::vector<int>& succ, std::vector<int>& pred) const {
+        succ.assign(data.customers.size() + 1, 0);
+        pred.assign(data.customers.size() + 1, 0);
+        for (const auto& r : routes)
+            for (size_t k = 0; k < r.customers.size(); ++k) {
+                pred[r.customers[k]] = k == 0 ? 0 : r.customers[k - 1];
+                succ[r.customers[k]] = k + 1 == r.customers.size() ? 0 : r.customers[k + 1];
+            }
+    }
+
+    // HGS broken-pairs distance from neighbours() arrays: the fraction of customers whose
+    // successor in a is neither neighbour in b, 0 for equal solutions; O(n)
+    static double brokenPairs(const std::vector<int>& succA, const std::vector<int>& predA,
+                              const std::vector<int>& succB, const std::vector<int>& predB) {
+        size_t n = succA.size() - 1, differences = 0;
+        for (size_t j = 1; j <= n; ++j) {
+            if (succA[j] != succB[j] && succA[j] != predB[j]) ++differences;
+            if (predA[j] == 0 && predB[j] != 0 && succB[j] != 0) ++differences;
+        }
+        return n ? double(differences) / n : 0.0;
+    }
+
+    // Broken-pairs distance from this solution to other, with per-thread buffers
+    double brokenPairsDistance(const ProblemData& data, const Solution& other) const {
+        thread_local std::vector<int> succA, predA, succB, predB;
+        neighbours(data, succA, predA);
+        other.neighbours(data, succB, predB);
+        return brokenPairs(succA, predA, succB, predB);
+    }
+
+    // Copy other into this solution, recycling route buffers through the spare pool. A route
+    // whose version matches other's route at the same index is already equal and is skipped.
+    void assign(const Solution& other) {
+        while (routes.size() > other.routes.size()) {
+            spare.routes.push_back(std::move(routes.back()));
+            routes.pop_back();
+        }
+        while (routes.size() < other.routes.size()) routes.push_back(takeSpare());
+        for (size_t r = 0; r < routes.size(); ++r) {
+            if (routes[r].version && routes[r].version == other.routes[r].version) {
+                checkSameRoute(routes[r], other.routes[r]);
+                continue;
+            }
+            routes[r] = other.routes[r];
+        }
+        totalCost = other.totalCost;
+        fingerprint = other.fingerprint;
+    }
+
+    // Give every route edited since it was last versioned a fresh version
+    void stampRoutes() {
+        for (auto& r : routes)
+            if (!r.version) r.version = Route::newVersion();
+    }
+
+    // Throws if two routes with the same version differ: some in-place edit missed its reset
+    static void checkSameRoute(const Route& a, const Route& b) {
+#ifdef VRP_CHECK_COSTS
+        if (a.vehicleId != b.vehicleId || a.customers != b.customers)
+            throw std::runtime_error("Route edited in place without resetting its version");
+#else
+        (void)a; (void)b;
+#endif
+    }
+
+    // Append an empty route, reusing a spare buffer when one is available
+    size_t openRoute(int vehicleId) {
+        routes.push_back(takeSpare());
+        Route& r = routes.back();
+        r.vehicleId = vehicleId;
+        r.currentLoad = 0;
+        r.totalDistance = 0.0;
+        return routes.size() - 1;
+    }
+
+    // Remove empty routes (keeping the order of the others) and keep their buffers
+    void dropEmptyRoutes() {
+        size_t kept = 0;
+        for (size_t r = 0; r < routes.size(); ++r)
+            if (!routes[r].customers.empty()) std::swap(routes[kept++], routes[r]);
+        while (routes.size() > kept) {
+            spare.routes.push_back(std::move(routes.back()));
+            routes.pop_back();
+        }
+    }
 
     // Calculate the total cost of all routes
     void calculateTotalCost(const ProblemData& data) {
@@ -138,112 +941,2934 @@ public:
         for (auto& r : routes) {
             r.totalDistance = 0.0;
             if (r.customers.empty()) continue;
-            r.totalDistance += data.getDistance(data.depot.id, r.customers.front().id);
+            r.totalDistance += data.getDistance(data.depot.id, r.customers.front());
             for (size_t i = 0; i < r.customers.size() - 1; ++i)
-                r.totalDistance += data.getDistance(r.customers[i].id, r.customers[i + 1].id);
-            r.totalDistance += data.getDistance(r.customers.back().id, data.depot.id);
+                r.totalDistance += data.getDistance(r.customers[i], r.customers[i + 1]);
+            r.totalDistance += data.getDistance(r.customers.back(), data.depot.id);
             totalCost += r.totalDistance;
         }
+        computeFingerprint();
+    }
+
+    // Reserve every route, plus spares up to one more than the fleet, for the longest
+    // capacity-feasible route, so moves and copies reuse buffers instead of reallocating
+    void reserveBuffers(const ProblemData& data) {
+        int capacity = data.maxCapacity(), minDemand = INT_MAX;
+        for (size_t id = 1; id <= data.customers.size(); ++id) minDemand = std::min(minDemand, data.demand(id));
+        size_t stops = std::min(data.customers.size(), size_t(capacity / std::max(1, minDemand)));
+        routes.reserve(data.vehicles.size() + 1);
+        spare.routes.reserve(data.vehicles.size() + 1);
+        while (routes.size() + spare.routes.size() < data.vehicles.size() + 1) spare.routes.emplace_back();
+        for (auto& r : spare.routes) r.customers.reserve(stops + 1);
+        for (auto& r : routes) r.customers.reserve(stops + 1);
+    }
+
+    // --- Incremental moves ---
+    // Each move applies its distance delta to the touched routes and to totalCost, so
+    // callers never need calculateTotalCost after a move. Building with VRP_CHECK_COSTS
+    // cross-checks every move against a full recomputation.
+
+    void insertCustomer(const ProblemData& data, size_t r, size_t pos, NodeId id) {
+        Route& route = routes[r];
+        double delta = data.getDistance(stop(data, route, pos - 1), id) + data.getDistance(id, stop(data, route, pos)) -
+                       data.getDistance(stop(data, route, pos - 1), stop(data, route, pos));
+        fingerprint += edgeKey(stop(data, route, pos - 1), id) + edgeKey(id, stop(data, route, pos)) -
+                       edgeKey(stop(data, route, pos - 1), stop(data, route, pos));
+        route.customers.insert(route.customers.begin() + pos, id);
+        route.currentLoad += data.demand(id);
+        applyDelta(route, delta);
+        checkCosts(data);
+    }
+
+    NodeId removeCustomer(const ProblemData& data, size_t r, size_t pos) {
+        Route& route = routes[r];
+        NodeId id = route.customers[pos];
+        double delta = data.getDistance(stop(data, route, pos - 1), stop(data, route, pos + 1)) -
+                       data.getDistance(stop(data, route, pos - 1), id) - data.getDistance(id, stop(data, route, pos + 1));
+        fingerprint += edgeKey(stop(data, route, pos - 1), stop(data, route, pos + 1)) -
+                       edgeKey(stop(data, route, pos - 1), id) - edgeKey(id, stop(data, route, pos + 1));
+        route.customers.erase(route.customers.begin() + pos);
+        route.currentLoad -= data.demand(id);
+        applyDelta(route, delta);
+        checkCosts(data);
+        return id;
+    }
+
+    // Move the customer at (from, i) so it ends up at position j of route to
+    void relocateCustomer(const ProblemData& data, size_t from, size_t i, size_t to, size_t j) {
+        NodeId id = removeCustomer(data, from, i);
+        insertCustomer(data, to, j, id);
+    }
+
+    void swapCustomers(const ProblemData& data, size_t a, size_t i, size_t b, size_t j) {
+        NodeId u = routes[a].customers[i], v = routes[b].customers[j];
+        if (a == b) {
+            removeCustomer(data, a, std::max(i, j));
+            removeCustomer(data, a, std::min(i, j));
+            insertCustomer(data, a, std::min(i, j), i < j ? v : u);
+            insertCustomer(data, a, std::max(i, j), i < j ? u : v);
+            return;
+        }
+        Route &A = routes[a], &B = routes[b];
+        double dA = data.getDistance(stop(data, A, i - 1), v) + data.getDistance(v, stop(data, A, i + 1)) -
+                    data.getDistance(stop(data, A, i - 1), u) - data.getDistance(u, stop(data, A, i + 1));
+        double dB = data.getDistance(stop(data, B, j - 1), u) + data.getDistance(u, stop(data, B, j + 1)) -
+                    data.getDistance(stop(data, B, j - 1), v) - data.getDistance(v, stop(data, B, j + 1));
+        fingerprint += edgeKey(stop(data, A, i - 1), v) + edgeKey(v, stop(data, A, i + 1)) -
+                       edgeKey(stop(data, A, i - 1), u) - edgeKey(u, stop(data, A, i + 1)) +
+                       edgeKey(stop(data, B, j - 1), u) + edgeKey(u, stop(data, B, j + 1)) -
+                       edgeKey(stop(data, B, j - 1), v) - edgeKey(v, stop(data, B, j + 1));
+        std::swap(A.customers[i], B.customers[j]);
+        int shift = data.demand(v) - data.demand(u);
+        A.currentLoad += shift;
+        B.currentLoad -= shift;
+        applyDelta(A, dA);
+        applyDelta(B, dB);
+        checkCosts(data);
+    }
+
+    // 2-opt move: reverse positions i..j of route r
+    void reverseSegment(const ProblemData& data, size_t r, size_t i, size_t j) {
+        Route& route = routes[r];
+        double delta = data.getDistance(stop(data, route, i - 1), route.customers[j]) +
+                       data.getDistance(route.customers[i], stop(data, route, j + 1)) -
+                       data.getDistance(stop(data, route, i - 1), route.customers[i]) -
+                       data.getDistance(route.customers[j], stop(data, route, j + 1));
+        fingerprint += edgeKey(stop(data, route, i - 1), route.customers[j]) +
+                       edgeKey(route.customers[i], stop(data, route, j + 1)) -
+                       edgeKey(stop(data, route, i - 1), route.customers[i]) -
+                       edgeKey(route.customers[j], stop(data, route, j + 1));
+        std::reverse(route.customers.begin() + i, route.customers.begin() + j + 1);
+        applyDelta(route, delta);
+        checkCosts(data);
     }
 
-    // Check if the solution is valid
-    bool isValid(const ProblemData& data) const {
-        std::set<int> visited;
+    // Run twoOptRoute on route r and fold its gain into totalCost (the fingerprint of the
+    // route is rehashed, which is no more than the O(length^2) 2-opt itself)
+    void improveRoute(const ProblemData& data, size_t r) {
+        double before = routes[r].totalDistance;
+        fingerprint -= routeFingerprint(routes[r]);
+        routes[r].version = 0;
+        twoOptRoute(data, routes[r]);
+        fingerprint += routeFingerprint(routes[r]);
+        totalCost += routes[r].totalDistance - before;
+        checkCosts(data);
+    }
+
+    // Throws if the incrementally kept distances drifted from a full recomputation
+    void verifyCosts(const ProblemData& data) const {
+        double total = 0.0;
         for (const auto& r : routes) {
-            if (r.vehicleId < 0 || r.vehicleId >= data.vehicles.size()) return false;
-            if (r.currentLoad > data.vehicles[r.vehicleId].capacity) return false;
-            for (const auto& c : r.customers) visited.insert(c.id);
+            double dist = r.customers.empty() ? 0.0 : routeDistance(data, r.customers);
+            if (std::fabs(dist - r.totalDistance) > 1e-6 * std::max(1.0, dist))
+                throw std::runtime_error("Route distance out of sync: " + std::to_string(r.totalDistance) +
+                                         " kept, " + std::to_string(dist) + " recomputed");
+            if (std::fabs(routeSegment(data, r).distance - dist) > 1e-6 * std::max(1.0, dist))
+                throw std::runtime_error("Route segment distance disagrees with the route");
+            total += dist;
         }
-        return visited.size() == data.customers.size();
+        if (std::fabs(total - totalCost) > 1e-6 * std::max(1.0, total))
+            throw std::runtime_error("Total cost out of sync: " + std::to_string(totalCost) + " kept, " +
+                                     std::to_string(total) + " recomputed");
+        uint64_t hash = 0;
+        for (const auto& r : routes) hash += routeFingerprint(r);
+        if (hash != fingerprint) throw std::runtime_error("Fingerprint out of sync");
     }
-    void optimizeRoutes2Opt(const ProblemData& data) {
-    for (auto& route : routes) {
+
+    // Check if the solution is valid (see SolutionValidator for the violation report). Route
+    // count and one-route-per-vehicle are only checked when checkFleetSize is set.
+    bool isValid(const ProblemData& data, bool checkFleetSize = false) const;
+
+    // Improve a single route with 2-opt until no improving move is left
+    static void twoOptRoute(const ProblemData& data, Route& route) {
         bool improved = true;
         int n = route.customers.size();
-        if (n < 4) continue; // no need for 2-opt on routes with less than 4 customers
+        if (n < 4) return; // no need for 2-opt on routes with less than 4 customers
 
         while (improved) {
             improved = false;
             for (int i = 0; i < n - 1; ++i) {
                 for (int j = i + 2; j < n; ++j) {
                     if (j + 1 >= n) continue; // Out-of-bounds prevention
-                    double before = data.getDistance(route.customers[i].id, route.customers[i + 1].id) +
-                                    data.getDistance(route.customers[j].id, route.customers[j + 1].id);
-                    double after = data.getDistance(route.customers[i].id, route.customers[j].id) +
-                                   data.getDistance(route.customers[i + 1].id, route.customers[j + 1].id);
+                    double before = data.getDistance(route.customers[i], route.customers[i + 1]) +
+                                    data.getDistance(route.customers[j], route.customers[j + 1]);
+                    double after = data.getDistance(route.customers[i], route.customers[j]) +
+                                   data.getDistance(route.customers[i + 1], route.customers[j + 1]);
                     if (after < before) {
                         std::reverse(route.customers.begin() + i + 1, route.customers.begin() + j + 1);
+                        route.totalDistance += after - before;
                         improved = true;
                     }
                 }
             }
         }
     }
-    calculateTotalCost(data);
-}
-};
-
-class ClarkeWright {
-public:
-    ClarkeWright(const ProblemData& d) : data(d) {}
-    Solution solve();
 
-private:
-    const ProblemData& data;
-    struct Savings { double value; int i, j; bool operator<(const Savings& s) const { return value > s.value; } };
-    std::pair<int, int> findCustomer(int id, const std::vector<Route>& r) const;
-};
+    // 2-opt and Or-opt (chains of 1-3 customers, both orientations) driven by
+    // nearest-neighbour candidate lists. Moves are applied on a TwoLevelTour so
+    // each reversal is O(sqrt(n)); meant for long routes.
+    static void polishRoute(const ProblemData& data, Route& route) {
+        const int kNeighbours = 8;
+        const double eps = 1e-9;
+        int n = route.customers.size() + 1; // local node 0 is the depot
+        std::vector<int> ids(n), order(n);
+        ids[0] = data.depot.id;
+        for (int k = 1; k < n; ++k) { ids[k] = route.customers[k - 1]; order[k] = k; }
+        auto d = [&](int u, int v) { return data.getDistance(ids[u], ids[v]); };
+        int k = std::min(kNeighbours, n - 1);
+        std::vector<int> neigh(n * k), cand(n);
+        for (int u = 0; u < n; ++u) {
+            for (int v = 0; v < n; ++v) cand[v] = v;
+            std::swap(cand[u], cand[n - 1]);
+            std::partial_sort(cand.begin(), cand.begin() + k, cand.end() - 1,
+                              [&](int x, int y) { return d(u, x) < d(u, y); });
+            std::copy(cand.begin(), cand.begin() + k, neigh.begin() + u * k);
+        }
+        TwoLevelTour tour;
+        tour.build(order);
 
-std::pair<int, int> ClarkeWright::findCustomer(int id, const std::vector<Route>& routes) const {
-    for (size_t i = 0; i < routes.size(); ++i)
-        for (size_t j = 0; j < routes[i].customers.size(); ++j)
-            if (routes[i].customers[j].id == id) return {(int)i, (int)j};
-    return {-1, -1};
-}
+        bool improved = true;
+        while (improved) {
+            improved = false;
+            for (int a = 0; a < n; ++a) {
+                // 2-opt: replace (a, na), (c, nc) with (a, c), (na, nc)
+                for (int t = 0; t < k; ++t) {
+                    int c = neigh[a * k + t], na = tour.next(a), nc = tour.next(c);
+                    double g1 = d(a, na) - d(a, c);
+                    if (g1 <= eps) break;
+                    if (g1 + d(c, nc) - d(na, nc) <= eps) continue;
+                    if (tour.before(a, c)) tour.reverse(na, c); else tour.reverse(nc, a);
+                    improved = true;
+                }
+                if (a == 0) continue;
+                // Or-opt: move the chain a..e next to one of a's neighbours
+                int e = a;
+                for (int len = 1; len <= 3; ++len, e = tour.next(e)) {
+                    if (e == 0) break;
+                    int p = tour.prev(a), q = tour.next(e);
+                    double removeGain = d(p, a) + d(e, q) - d(p, q);
+                    if (removeGain <= eps) continue;
+                    for (int t = 0; t < k; ++t) {
+                        int c = neigh[a * k + t];
+                        if (c == p || c == e || (tour.before(a, c) && tour.before(c, e))) continue;
+                        int nc = tour.next(c);
+                        double add = d(c, a) + d(e, nc) - d(c, nc);      // c a..e nc
+                        double addRev = d(c, e) + d(a, nc) - d(c, nc);   // c e..a nc
+                        if (std::min(add, addRev) >= removeGain - eps) continue;
+                        // Two reversals put the chain reversed between c and nc
+                        if (tour.before(e, c)) { tour.reverse(a, c); tour.reverse(c, q); }
+                        else { tour.reverse(nc, e); tour.reverse(p, nc); }
+                        if (add < addRev) tour.reverse(e, a);
+                        improved = true;
+                        break;
+                    }
+                    if (improved) break;
+                }
+            }
+        }
 
-Solution ClarkeWright::solve() {
-    std::vector<Route> routes;
-    for (const auto& c : data.customers) {
-        Route r; r.vehicleId = c.id % data.vehicles.size();
-        r.customers.push_back(c); r.currentLoad = 1; routes.push_back(r);
+        std::vector<NodeId> seq;
+        seq.reserve(n - 1);
+        tour.forEach([&](int u) { if (u != 0) seq.push_back(ids[u]); });
+        if (routeDistance(data, seq) < routeDistance(data, route.customers) - eps) route.customers = seq;
     }
-    std::vector<Savings> savings;
-    for (size_t i = 0; i < data.customers.size(); ++i)
-        for (size_t j = i + 1; j < data.customers.size(); ++j) {
-            double s = data.getDistance(0, data.customers[i].id) +
-                       data.getDistance(0, data.customers[j].id) -
-                       data.getDistance(data.customers[i].id, data.customers[j].id);
-            savings.push_back({s, (int)i, (int)j});
+
+    // Optimal sequence by Held-Karp dynamic programming, for short routes only
+    static const int kExactMaxCustomers = 12;
+    static void exactRoute(const ProblemData& data, Route& route) {
+        int n = route.customers.size();
+        if (n < 3 || n > kExactMaxCustomers) return;
+        const double inf = std::numeric_limits<double>::infinity();
+        size_t full = size_t(1) << n;
+        thread_local std::vector<double> dp;
+        thread_local std::vector<int8_t> parent;
+        dp.assign(full * n, inf);
+        parent.assign(full * n, -1);
+        auto id = [&](int k) { return route.customers[k]; };
+        for (int k = 0; k < n; ++k) dp[(size_t(1) << k) * n + k] = data.getDistance(data.depot.id, id(k));
+        for (size_t mask = 1; mask < full; ++mask) {
+            for (int last = 0; last < n; ++last) {
+                double v = dp[mask * n + last];
+                if (v == inf) continue;
+                for (int nxt = 0; nxt < n; ++nxt) {
+                    if (mask & (size_t(1) << nxt)) continue;
+                    size_t nm = mask | (size_t(1) << nxt);
+                    double cand = v + data.getDistance(id(last), id(nxt));
+                    if (cand < dp[nm * n + nxt]) { dp[nm * n + nxt] = cand; parent[nm * n + nxt] = last; }
+                }
+            }
         }
-    std::sort(savings.begin(), savings.end());
+        double best = inf; int last = -1;
+        for (int k = 0; k < n; ++k) {
+            double v = dp[(full - 1) * n + k] + data.getDistance(id(k), data.depot.id);
+            if (v < best) { best = v; last = k; }
+        }
+        if (best >= routeDistance(data, route.customers) - 1e-9) return;
+        std::vector<NodeId> seq(n, route.customers[0]);
+        size_t mask = full - 1;
+        for (int pos = n - 1; pos >= 0; --pos) {
+            seq[pos] = route.customers[last];
+            int prev = parent[mask * n + last];
+            mask &= ~(size_t(1) << last);
+            last = prev;
+        }
+        route.customers = seq;
+    }
 
-    for (const auto& s : savings) {
-        int id1 = data.customers[s.i].id, id2 = data.customers[s.j].id;
-        auto [ri, pi] = findCustomer(id1, routes);
-        auto [rj, pj] = findCustomer(id2, routes);
-        if (ri == rj || ri == -1 || rj == -1) continue;
-        auto& R1 = routes[ri], R2 = routes[rj];
-        if ((pi != 0 && pi != R1.customers.size() - 1) ||
-            (pj != 0 && pj != R2.customers.size() - 1)) continue;
-        if (R1.currentLoad + R2.currentLoad > data.vehicles[R1.vehicleId].capacity) continue;
-        Route merged(R1.vehicleId);
-        merged.currentLoad = R1.currentLoad + R2.currentLoad;
-        if (pi == R1.customers.size() - 1 && pj == 0) {
-            merged.customers = R1.customers;
-            merged.customers.insert(merged.customers.end(), R2.customers.begin(), R2.customers.end());
-        } else if (pi == 0 && pj == R2.customers.size() - 1) {
-            merged.customers = R2.customers;
-            merged.customers.insert(merged.customers.end(), R1.customers.begin(), R1.customers.end());
-        } else continue;
-        routes.erase(routes.begin() + std::max(ri, rj));
-        routes.erase(routes.begin() + std::min(ri, rj));
-        routes.push_back(merged);
+    // Intra-route optimization of one route: exact DP when short, 2-opt + Or-opt otherwise.
+    // A cache hit replaces the search with the best known sequence.
+    static void optimizeRoute(const ProblemData& data, Route& route, RouteCostCache* cache) {
+        if (route.customers.size() < 3) return;
+        route.version = 0;
+        std::vector<int> cachedSeq;
+        double cachedCost;
+        if (cache && cache->lookup(route.customers, cachedSeq, cachedCost)) {
+            double current = routeDistance(data, route.customers);
+            if (cachedCost < current) {
+                for (size_t k = 0; k < cachedSeq.size(); ++k) route.customers[k] = cachedSeq[k];
+            } else if (current < cachedCost) {
+                cache->store(route.customers, current);
+            }
+            return;
+        }
+        if ((int)route.customers.size() <= kExactMaxCustomers) {
+            exactRoute(data, route);
+        } else {
+            polishRoute(data, route);
+        }
+        if (cache) cache->store(route.customers, routeDistance(data, route.customers));
     }
 
-    Solution sol; sol.routes = routes; sol.calculateTotalCost(data);
+    // Optimize every route. With a pool, routes run in parallel longest-first; each
+    // route's result does not depend on scheduling and the total is summed serially
+    // in route order, so the cost matches the serial run bit-for-bit. Routes not yet
+    // started when the deadline passes are left as they are.
+    void optimizeRoutes(const ProblemData& data, RouteCostCache* cache = nullptr, ThreadPool* pool = nullptr,
+                        Clock::time_point deadline = Clock::time_point::max()) {
+        if (pool) {
+            std::vector<size_t> order(routes.size());
+            for (size_t k = 0; k < order.size(); ++k) order[k] = k;
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return routes[a].customers.size() > routes[b].customers.size();
+            });
+            ThreadPool::TaskGroup group;
+            for (size_t k : order)
+                pool->submit([this, &data, cache, deadline, k] {
+                    if (Clock::now() < deadline) optimizeRoute(data, routes[k], cache);
+                }, &group);
+            pool->wait(group);
+        } else {
+            for (auto& route : routes)
+                if (Clock::now() < deadline) optimizeRoute(data, route, cache);
+        }
+        calculateTotalCost(data);
+    }
+
+private:
+    Route takeSpare() {
+        if (spare.routes.empty()) return Route();
+        Route r = std::move(spare.routes.back());
+        spare.routes.pop_back();
+        r.customers.clear();
+        r.version = 0; // the buffer no longer holds the route its version named
+        return r;
+    }
+
+    static int stop(const ProblemData& data, const Route& r, size_t k) {
+        return k >= r.customers.size() ? data.depot.id : r.customers[k]; // size_t(-1) wraps to the depot too
+    }
+
+    void applyDelta(Route& r, double delta) {
+        r.version = 0;
+        r.totalDistance += delta;
+        totalCost += delta;
+    }
+
+    void checkCosts(const ProblemData& data) const {
+#ifdef VRP_CHECK_COSTS
+        verifyCosts(data);
+#else
+        (void)data;
+#endif
+    }
+};
+
+// --- Solution Validator ---
+// O(n) check of coverage, duplicates, node ids, vehicle ids, stored loads, capacity and
+// fleet size (route count, one route per vehicle). Coverage uses epoch arrays, so
+// validate() does not allocate after construction; the first maxReports violations are
+// kept with their route and position.
+class SolutionValidator {
+public:
+    enum class Kind { BadVehicle, BadNode, Duplicate, Missing, LoadMismatch, OverCapacity, TooManyRoutes, SharedVehicle };
+    struct Violation { Kind kind; int route; int position; int node; };
+
+    static const size_t maxReports = 64;
+    bool checkFleetSize = true; // off for work solutions that may exceed the fleet mid-search
+
+    explicit SolutionValidator(const ProblemData& d)
+        : data(d), seen(d.customers.size() + 1, 0), vehicleSeen(d.vehicles.size(), 0) {
+        found.reserve(maxReports);
+    }
+
+    bool validate(const Solution& sol) {
+        found.clear();
+        total = 0;
+        if (seen.size() != data.customers.size() + 1 || vehicleSeen.size() != data.vehicles.size()) {
+            seen.assign(data.customers.size() + 1, 0); // the instance was reloaded
+            vehicleSeen.assign(data.vehicles.size(), 0);
+            epoch = 0;
+        }
+        if (++epoch == 0) {
+            std::fill(seen.begin(), seen.end(), 0);
+            std::fill(vehicleSeen.begin(), vehicleSeen.end(), 0);
+            epoch = 1;
+        }
+        int n = data.customers.size();
+        if (checkFleetSize && sol.routes.size() > data.vehicles.size()) report(Kind::TooManyRoutes, -1, -1, sol.routes.size());
+        for (size_t r = 0; r < sol.routes.size(); ++r) {
+            const Route& route = sol.routes[r];
+            int load = 0;
+            for (size_t k = 0; k < route.customers.size(); ++k) {
+                int id = route.customers[k];
+                if (id < 1 || id > n) { report(Kind::BadNode, r, k, id); continue; }
+                if (seen[id] == epoch) report(Kind::Duplicate, r, k, id);
+                seen[id] = epoch;
+                load += data.demand(id);
+            }
+            if (load != route.currentLoad) report(Kind::LoadMismatch, r, -1, route.currentLoad - load);
+            if (route.vehicleId < 0 || route.vehicleId >= (int)data.vehicles.size()) report(Kind::BadVehicle, r, -1, route.vehicleId);
+            else {
+                if (load > data.vehicles[route.vehicleId].capacity) report(Kind::OverCapacity, r, -1, load);
+                if (checkFleetSize && vehicleSeen[route.vehicleId] == epoch) report(Kind::SharedVehicle, r, -1, route.vehicleId);
+                vehicleSeen[route.vehicleId] = epoch;
+            }
+        }
+        for (int id = 1; id <= n; ++id)
+            if (seen[id] != epoch) report(Kind::Missing, -1, -1, id);
+        return total == 0;
+    }
+
+    // Violations of the last validate() call; count() includes those beyond maxReports
+    const std::vector<Violation>& violations() const { return found; }
+    size_t count() const { return total; }
+    const ProblemData& instance() const { return data; }
+
+    void print(std::ostream& out) const {
+        static const char* names[] = {"bad vehicle", "bad node", "duplicate customer", "missing customer",
+                                      "load mismatch", "over capacity", "too many routes", "shared vehicle"};
+        for (const auto& v : found) {
+            out << "Violation: " << names[(int)v.kind];
+            if (v.route >= 0) out << " in route " << v.route + 1;
+            if (v.position >= 0) out << " at position " << v.position;
+            out << " (" << v.node << ")\n";
+        }
+        if (total > found.size()) out << "... " << total - found.size() << " more violations\n";
+    }
+
+private:
+    const ProblemData& data;
+    std::vector<uint32_t> seen, vehicleSeen;
+    uint32_t epoch = 0;
+    std::vector<Violation> found;
+    size_t total = 0;
+
+    void report(Kind kind, int route, int position, int node) {
+        if (found.size() < maxReports) found.push_back({kind, route, position, node});
+        ++total;
+    }
+};
+
+// One validator per thread and instance, so repeated checks do not allocate
+bool Solution::isValid(const ProblemData& data, bool checkFleetSize) const {
+    static thread_local std::unique_ptr<SolutionValidator> validator;
+    if (!validator || &validator->instance() != &data) validator.reset(new SolutionValidator(data));
+    validator->checkFleetSize = checkFleetSize;
+    return validator->validate(*this);
+}
+
+// --- Vehicle Assignment ---
+
+// Vehicle for a new route starting with load: the unused vehicle with the lowest fixed cost
+// that fits it, or -1 if every vehicle that fits is taken
+int freeVehicle(const ProblemData& data, const Solution& sol, int load) {
+    static thread_local std::vector<char> used;
+    used.assign(data.vehicles.size(), 0);
+    for (const auto& r : sol.routes)
+        if (r.vehicleId >= 0 && r.vehicleId < (int)used.size()) used[r.vehicleId] = 1;
+    int best = -1;
+    for (const auto& v : data.vehicles)
+        if (!used[v.id] && v.capacity >= load && (best < 0 || v.fixedCost < data.vehicles[best].fixedCost)) best = v.id;
+    return best;
+}
+
+// Post-merge assignment of vehicles to routes (route distances must be current). Routes in
+// decreasing load each take the fitting type with the lowest fixed + distance cost that has
+// a vehicle left. Every later route fits a superset of types, so this finds a one-to-one
+// assignment whenever one exists; O(R log R + R * types). Once the fleet runs out, leftover
+// routes share the cheapest fitting vehicle and false is returned.
+bool assignVehicles(const ProblemData& data, Solution& sol) {
+    static thread_local std::vector<int> order, taken;
+    order.resize(sol.routes.size());
+    for (size_t r = 0; r < order.size(); ++r) order[r] = r;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return sol.routes[a].currentLoad > sol.routes[b].currentLoad;
+    });
+    const auto& types = data.fleetTypes;
+    taken.assign(types.size(), 0);
+    bool oneToOne = true;
+    for (int r : order) {
+        Route& route = sol.routes[r];
+        int pick = -1, shared = 0;
+        double pickCost = 0.0, sharedCost = std::numeric_limits<double>::infinity();
+        for (size_t t = 0; t < types.size() && types[t].capacity >= route.currentLoad; ++t) {
+            double cost = types[t].fixedCost + types[t].costPerDistance * route.totalDistance;
+            if (taken[t] < (int)types[t].ids.size() && (pick < 0 || cost < pickCost)) { pick = t; pickCost = cost; }
+            if (cost < sharedCost) { shared = t; sharedCost = cost; }
+        }
+        int before = route.vehicleId;
+        if (pick >= 0) route.vehicleId = types[pick].ids[taken[pick]++];
+        else { route.vehicleId = types[shared].ids.front(); oneToOne = false; }
+        if (route.vehicleId != before) route.version = 0;
+    }
+    return oneToOne;
+}
+
+// Open an empty route on a vehicle of its own for a first customer of this load. When every
+// vehicle that fits is taken but Hall's condition still holds with the new route, routes
+// are reassigned to free one (a light route may move to a smaller vehicle). Returns false,
+// leaving sol unchanged, if the fleet has no vehicle for another route of this load.
+bool openFleetRoute(const ProblemData& data, Solution& sol, int load) {
+    if (load > data.maxCapacity()) return false;
+    int v = freeVehicle(data, sol, load);
+    if (v < 0) {
+        static thread_local std::vector<int> counts;
+        counts.assign(data.levelCapacity.size(), 0);
+        for (const auto& r : sol.routes) data.addToLevels(counts, r.currentLoad);
+        data.addToLevels(counts, load);
+        if (!data.levelsFit(counts)) return false;
+    }
+    size_t r = sol.openRoute(v);
+    if (v < 0) {
+        sol.routes[r].currentLoad = load; // stands in for the customer while vehicles are reassigned
+        assignVehicles(data, sol);
+        sol.routes[r].currentLoad = 0;
+    }
+    return true;
+}
+
+// Fixed cost of every vehicle used plus the distance cost of each route
+double fleetCost(const ProblemData& data, const Solution& sol) {
+    std::vector<char> used(data.vehicles.size(), 0);
+    double cost = 0.0;
+    for (const auto& r : sol.routes) {
+        const Vehicle& v = data.vehicles[r.vehicleId];
+        if (!used[v.id]) { used[v.id] = 1; cost += v.fixedCost; }
+        cost += v.costPerDistance * r.totalDistance;
+    }
+    return cost;
+}
+
+// Load, capacity utilization, distance and cost of every vehicle in use
+void printFleetUsage(const ProblemData& data, const Solution& sol, std::ostream& out) {
+    struct Usage { int routes = 0, load = 0; double distance = 0.0; };
+    std::vector<Usage> usage(data.vehicles.size());
+    for (const auto& r : sol.routes) {
+        Usage& u = usage[r.vehicleId];
+        ++u.routes; u.load += r.currentLoad; u.distance += r.totalDistance;
+    }
+    int used = 0;
+    long long load = 0, capacity = 0;
+    for (const auto& v : data.vehicles) {
+        const Usage& u = usage[v.id];
+        if (u.routes == 0) continue;
+        ++used; load += u.load; capacity += (long long)v.capacity * u.routes;
+        out << "Vehicle " << v.id << " (Capacity " << v.capacity << "): " << u.routes << " route(s), Load "
+            << u.load << ", Utilization " << 100.0 * u.load / ((double)v.capacity * u.routes) << "%, Distance "
+            << u.distance << ", Cost " << v.fixedCost + v.costPerDistance * u.distance << "\n";
+    }
+    out << "Vehicles used: " << used << "/" << data.vehicles.size() << ", Utilization: "
+        << (capacity ? 100.0 * load / capacity : 0.0) << "%, Fleet cost: " << fleetCost(data, sol) << "\n";
+}
+
+class ClarkeWright {
+public:
+    // shape weights the i-j distance in the saving d(0,i) + d(0,j) - shape * d(i,j); scratch
+    // memory comes from arena, or from a per-thread arena reset on every solve if none is given
+    ClarkeWright(const ProblemData& d, double shape = 1.0, SolverArena* arena = nullptr)
+        : data(d), shape(shape), arena(arena) {}
+    Solution solve();
+
+private:
+    const ProblemData& data;
+    double shape;
+    SolverArena* arena;
+    struct Savings { double value; int i, j; bool operator<(const Savings& s) const { return value > s.value; } };
+    std::pair<int, int> findCustomer(NodeId id, const std::vector<Route>& r) const;
+};
+
+std::pair<int, int> ClarkeWright::findCustomer(NodeId id, const std::vector<Route>& routes) const {
+    for (size_t i = 0; i < routes.size(); ++i)
+        for (size_t j = 0; j < routes[i].customers.size(); ++j)
+            if (routes[i].customers[j] == id) return {(int)i, (int)j};
+    return {-1, -1};
+}
+
+Solution ClarkeWright::solve() {
+    std::vector<Route> routes;
+    for (const auto& c : data.customers) {
+        Route r;
+        r.customers.push_back(c.id); r.currentLoad = data.demand(c.id); routes.push_back(std::move(r));
+    }
+    static thread_local SolverArena scratch;
+    SolverArena& mem = arena ? *arena : scratch;
+    size_t n = data.customers.size();
+    mem.reset(n * n / 2 * sizeof(Savings) + 4096);
+    std::pmr::vector<Savings> savings(mem.resource());
+    savings.reserve(n > 1 ? n * (n - 1) / 2 : 0);
+    for (size_t i = 0; i < data.customers.size(); ++i)
+        for (size_t j = i + 1; j < data.customers.size(); ++j) {
+            double s = data.getDistance(0, data.customers[i].id) +
+                       data.getDistance(0, data.customers[j].id) -
+                       shape * data.getDistance(data.customers[i].id, data.customers[j].id);
+            savings.push_back({s, (int)i, (int)j});
+        }
+    std::sort(savings.begin(), savings.end());
+
+    // Merge against the largest vehicle; vehicles are assigned once routes are final. To keep
+    // the routes packable into the fleet mix, a merge may not break Hall's condition at a
+    // capacity level it adds a heavy route to (see ProblemData::levelCapacity), checked with
+    // per-level counters in O(levels).
+    int capacity = data.maxCapacity();
+    std::vector<int> heavy(data.levelCapacity.size(), 0);
+    for (const auto& r : routes) data.addToLevels(heavy, r.currentLoad);
+
+    for (const auto& s : savings) {
+        int id1 = data.customers[s.i].id, id2 = data.customers[s.j].id;
+        auto [ri, pi] = findCustomer(id1, routes);
+        auto [rj, pj] = findCustomer(id2, routes);
+        if (ri == rj || ri == -1 || rj == -1) continue;
+        auto& R1 = routes[ri];
+        auto& R2 = routes[rj];
+        if ((pi != 0 && pi != R1.customers.size() - 1) ||
+            (pj != 0 && pj != R2.customers.size() - 1)) continue;
+        int load = R1.currentLoad + R2.currentLoad;
+        if (load > capacity) continue;
+        bool packable = true;
+        for (size_t k = 0; k < heavy.size() && packable; ++k) {
+            int delta = data.heavyAt(load, k) - data.heavyAt(R1.currentLoad, k) - data.heavyAt(R2.currentLoad, k);
+            packable = delta <= 0 || heavy[k] + delta <= data.levelVehicles[k];
+        }
+        if (!packable) continue;
+        // Append in place into the route that comes first, then move it out (no temporary copy)
+        Route* head;
+        if (pi == R1.customers.size() - 1 && pj == 0) {
+            R1.customers.insert(R1.customers.end(), R2.customers.begin(), R2.customers.end());
+            head = &R1;
+        } else if (pi == 0 && pj == R2.customers.size() - 1) {
+            R2.customers.insert(R2.customers.end(), R1.customers.begin(), R1.customers.end());
+            head = &R2;
+        } else continue;
+        data.addToLevels(heavy, load);
+        data.addToLevels(heavy, R1.currentLoad, -1);
+        data.addToLevels(heavy, R2.currentLoad, -1);
+        Route merged = std::move(*head);
+        merged.currentLoad = load;
+        routes.erase(routes.begin() + std::max(ri, rj));
+        routes.erase(routes.begin() + std::min(ri, rj));
+        routes.push_back(std::move(merged));
+    }
+
+    Solution sol; sol.routes = std::move(routes); sol.calculateTotalCost(data);
+    assignVehicles(data, sol);
+    return sol;
+}
+
+// --- Inter-Route Local Search ---
+// First-improvement relocate (inter and intra route) and swap moves with O(1)
+// delta evaluation, followed by 2-opt on the routes that changed. Checks the
+// deadline between customers so it can be interrupted within microseconds.
+class LocalSearch {
+public:
+    LocalSearch(const ProblemData& d) : data(d), validator(d) {
+        validator.checkFleetSize = false; // moves never add routes, callers may start with too many
+    }
+
+    // Returns false if the deadline interrupted the search
+    bool run(Solution& sol, Clock::time_point deadline) {
+        segments.reset();
+        sol.computeFingerprint();
+        bool improved = true, finished = true;
+        while (improved) {
+            improved = false;
+            if (!relocatePass(sol, deadline, improved) || !swapPass(sol, deadline, improved)) { finished = false; break; }
+        }
+        sol.dropEmptyRoutes();
+        return finished;
+    }
+
+private:
+    const ProblemData& data;
+    SolutionValidator validator;
+    RouteSegments segments;
+
+    int at(const Route& r, int k) const {
+        return (k < 0 || k >= (int)r.customers.size()) ? data.depot.id : r.customers[k];
+    }
+    double d(int a, int b) const { return data.getDistance(a, b); }
+
+    // Builds with VRP_CHECK_SOLUTIONS validate the solution after every applied move
+    void checkMove(const Solution& sol) {
+#ifdef VRP_CHECK_SOLUTIONS
+        if (!validator.validate(sol)) {
+            validator.print(std::cerr);
+            throw std::runtime_error("Local search move produced an invalid solution");
+        }
+#else
+        (void)sol;
+#endif
+    }
+
+    bool relocatePass(Solution& sol, Clock::time_point deadline, bool& improved) {
+        for (size_t a = 0; a < sol.routes.size(); ++a) {
+            for (int i = 0; i < (int)sol.routes[a].customers.size(); ++i) {
+                if (Clock::now() >= deadline) return false;
+                Route& A = sol.routes[a];
+                int u = A.customers[i];
+                double removeGain = d(at(A, i - 1), u) + d(u, at(A, i + 1)) - d(at(A, i - 1), at(A, i + 1));
+                double bestDelta = -1e-9; int bestRoute = -1, bestPos = -1;
+                for (size_t b = 0; b < sol.routes.size(); ++b) {
+                    const Route& B = sol.routes[b];
+                    if (b != a && (B.customers.empty() ||
+                                   B.currentLoad + data.demand(u) > data.vehicles[B.vehicleId].capacity)) continue;
+                    for (int j = 0; j <= (int)B.customers.size(); ++j) {
+                        if (b == a && (j == i || j == i + 1)) continue;
+                        double delta = d(at(B, j - 1), u) + d(u, at(B, j)) - d(at(B, j - 1), at(B, j)) - removeGain;
+                        if (delta >= bestDelta) continue;
+                        // Inter-route targets are checked on segments; intra-route moves keep the load
+                        if (b != a && !data.feasible(segments.withInsertion(data, b, B, j, u), data.vehicles[B.vehicleId].capacity)) continue;
+                        bestDelta = delta; bestRoute = b; bestPos = j;
+                    }
+                }
+                if (bestRoute < 0) continue;
+                if (bestRoute == (int)a && bestPos > i) --bestPos;
+                sol.relocateCustomer(data, a, i, bestRoute, bestPos);
+                sol.improveRoute(data, a);
+                if (bestRoute != (int)a) sol.improveRoute(data, bestRoute);
+                segments.touch(a);
+                segments.touch(bestRoute);
+                checkMove(sol);
+                improved = true;
+                --i;
+            }
+        }
+        return true;
+    }
+
+    bool swapPass(Solution& sol, Clock::time_point deadline, bool& improved) {
+        for (size_t a = 0; a < sol.routes.size(); ++a) {
+            for (int i = 0; i < (int)sol.routes[a].customers.size(); ++i) {
+                if (Clock::now() >= deadline) return false;
+                Route& A = sol.routes[a];
+                int u = A.customers[i], pa = at(A, i - 1), na = at(A, i + 1);
+                for (size_t b = a + 1; b < sol.routes.size(); ++b) {
+                    Route& B = sol.routes[b];
+                    for (int j = 0; j < (int)B.customers.size(); ++j) {
+                        int v = B.customers[j], pb = at(B, j - 1), nb = at(B, j + 1);
+                        int shift = data.demand(v) - data.demand(u);
+                        if (A.currentLoad + shift > data.vehicles[A.vehicleId].capacity ||
+                            B.currentLoad - shift > data.vehicles[B.vehicleId].capacity) continue;
+                        double delta = d(pa, v) + d(v, na) - d(pa, u) - d(u, na) +
+                                       d(pb, u) + d(u, nb) - d(pb, v) - d(v, nb);
+                        if (delta >= -1e-9) continue;
+                        if (!data.feasible(segments.withReplacement(data, a, A, i, v), data.vehicles[A.vehicleId].capacity) ||
+                            !data.feasible(segments.withReplacement(data, b, B, j, u), data.vehicles[B.vehicleId].capacity)) continue;
+                        sol.swapCustomers(data, a, i, b, j);
+                        sol.improveRoute(data, a);
+                        sol.improveRoute(data, b);
+                        segments.touch(a);
+                        segments.touch(b);
+                        checkMove(sol);
+                        improved = true;
+                        u = A.customers[i]; pa = at(A, i - 1); na = at(A, i + 1);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+};
+
+// --- Lower Bound ---
+// Lagrangian K-forest bound: with the depot removed, a solution with K routes is a
+// spanning forest of K paths over the customers plus 2K depot edge ends. For fixed
+// node penalties the cheapest such structure is the MST minus its K-1 longest edges
+// plus the 2K cheapest depot ends (each customer at most twice), minimized over K.
+// Subgradient steps push customer degrees towards 2. On metric instances the radial
+// bound 2 * sum(q_i * d0i) / Q is also valid and the larger of the two is returned.
+class LowerBound {
+public:
+    int iterations = 300;
+    double startStep = 1.0; // subgradient step factor, halved after stallLimit non-improving steps
+    int stallLimit = 10;
+
+    explicit LowerBound(const ProblemData& d) : data(d) {}
+
+    double compute(double upperBound = std::numeric_limits<double>::infinity()) {
+        int n = data.customers.size();
+        if (n == 0) return 0.0;
+        cost.assign((n + 1) * (n + 1), 0.0);
+        for (int i = 0; i <= n; ++i)
+            for (int j = 0; j <= n; ++j) cost[i * (n + 1) + j] = std::min(data.getDistance(i, j), data.getDistance(j, i));
+        int capacity = data.maxCapacity(), totalDemand = 0;
+        for (int id = 1; id <= n; ++id) totalDemand += data.demand(id);
+        int kMin = std::max(1, (totalDemand + capacity - 1) / std::max(1, capacity));
+        int kMax = n; // valid for solutions with any number of routes, not only those within the fleet
+
+        std::vector<double> penalty(n + 1, 0.0);
+        std::vector<int> degree(n + 1);
+        double best = -std::numeric_limits<double>::infinity();
+        double mu = startStep;
+        int stall = 0;
+        for (int it = 0; it < iterations; ++it) {
+            double value = evaluate(penalty, kMin, kMax, degree);
+            if (value > best + 1e-9) { best = value; stall = 0; }
+            else if (++stall >= stallLimit) { mu *= 0.5; stall = 0; }
+            if (mu < 1e-4) break;
+            double norm = 0.0;
+            for (int i = 1; i <= n; ++i) norm += double(degree[i] - 2) * (degree[i] - 2);
+            if (norm == 0.0) break; // every customer has degree 2: the structure is a solution
+            double target = std::isfinite(upperBound) ? upperBound : value * 1.05;
+            double step = mu * std::max(target - value, 1e-3 * std::fabs(value)) / norm;
+            for (int i = 1; i <= n; ++i) penalty[i] += step * (degree[i] - 2);
+        }
+        return std::max(best, radialBound());
+    }
+
+    // 2 * sum(q_i * d0i) / Q, or 0 if the matrix violates the triangle inequality
+    double radialBound() const {
+        int n = data.customers.size(), capacity = data.maxCapacity();
+        if (capacity == 0 || !data.isMetric()) return 0.0;
+        double sum = 0.0;
+        for (int id = 1; id <= n; ++id)
+            sum += data.demand(id) * std::min(data.getDistance(0, id), data.getDistance(id, 0));
+        return 2.0 * sum / capacity;
+    }
+
+private:
+    const ProblemData& data;
+    std::vector<double> cost; // symmetric edge costs, filled by compute()
+
+    // Cheapest K-forest structure under the given penalties; fills customer degrees
+    double evaluate(const std::vector<double>& penalty, int kMin, int kMax, std::vector<int>& degree) const {
+        int n = data.customers.size();
+        // Prim's MST over the customers (ids 1..n) with penalized costs
+        std::vector<double> key(n + 1, std::numeric_limits<double>::infinity());
+        std::vector<int> parent(n + 1, 0);
+        std::vector<char> inTree(n + 1, 0);
+        struct TreeEdge { double w; int a, b; };
+        std::vector<TreeEdge> tree;
+        key[1] = 0.0;
+        for (int step = 0; step < n; ++step) {
+            int u = -1;
+            for (int v = 1; v <= n; ++v)
+                if (!inTree[v] && (u < 0 || key[v] < key[u])) u = v;
+            inTree[u] = 1;
+            if (step > 0) tree.push_back({key[u], parent[u], u});
+            const double* row = &cost[u * (n + 1)];
+            for (int v = 1; v <= n; ++v) {
+                if (inTree[v]) continue;
+                double w = row[v] + penalty[u] + penalty[v];
+                if (w < key[v]) { key[v] = w; parent[v] = u; }
+            }
+        }
+        std::sort(tree.begin(), tree.end(), [](const TreeEdge& a, const TreeEdge& b) { return a.w > b.w; });
+        double forest = 0.0;
+        for (const auto& e : tree) forest += e.w;
+
+        // Depot edge ends, each customer available twice
+        std::vector<std::pair<double, int>> ends;
+        for (int i = 1; i <= n; ++i) {
+            double w = cost[i] + penalty[i];
+            ends.push_back({w, i});
+            ends.push_back({w, i});
+        }
+        std::sort(ends.begin(), ends.end());
+
+        double bestValue = std::numeric_limits<double>::infinity();
+        int bestK = kMin;
+        double depotCost = 0.0;
+        for (int k = 1; k <= kMax; ++k) {
+            depotCost += ends[2 * k - 2].first + ends[2 * k - 1].first;
+            if (k > 1) forest -= tree[k - 2].w;
+            if (k >= kMin && forest + depotCost < bestValue) { bestValue = forest + depotCost; bestK = k; }
+        }
+
+        std::fill(degree.begin(), degree.end(), 0);
+        for (size_t e = bestK - 1; e < tree.size(); ++e) { ++degree[tree[e].a]; ++degree[tree[e].b]; }
+        for (int e = 0; e < 2 * bestK; ++e) ++degree[ends[e].second];
+        double penaltySum = 0.0;
+        for (int i = 1; i <= n; ++i) penaltySum += penalty[i];
+        return bestValue - 2.0 * penaltySum;
+    }
+};
+
+// Insert a customer at its cheapest capacity-feasible position, opening a route if none fits.
+// Returns false, leaving sol unchanged, if no route fits and none is opened: openRoute is false
+// or the fleet has no vehicle left for it. Callers that keep segments for sol pass them in;
+// the changed route is touched.
+bool insertCheapest(const ProblemData& data, Solution& sol, NodeId c, bool openRoute = true,
+                    RouteSegments* segments = nullptr) {
+    static thread_local RouteSegments scratch;
+    if (!segments) { scratch.reset(); segments = &scratch; }
+    double bestCost = std::numeric_limits<double>::infinity();
+    size_t bestRoute = sol.routes.size(), bestPos = 0;
+    for (size_t k = 0; k < sol.routes.size(); ++k) {
+        const Route& r = sol.routes[k];
+        if (r.customers.empty() || r.currentLoad + data.demand(c) > data.vehicles[r.vehicleId].capacity) continue;
+        for (size_t j = 0; j <= r.customers.size(); ++j) {
+            int p = j == 0 ? data.depot.id : r.customers[j - 1];
+            int q = j == r.customers.size() ? data.depot.id : r.customers[j];
+            double cost = data.getDistance(p, c) + data.getDistance(c, q) - data.getDistance(p, q);
+            if (cost < bestCost && data.feasible(segments->withInsertion(data, k, r, j, c), data.vehicles[r.vehicleId].capacity)) {
+                bestCost = cost; bestRoute = k; bestPos = j;
+            }
+        }
+    }
+    if (bestRoute == sol.routes.size() && (!openRoute || !openFleetRoute(data, sol, data.demand(c)))) return false;
+    sol.insertCustomer(data, bestRoute, bestPos, c);
+    segments->touch(bestRoute);
+    return true;
+}
+
+// --- Route Pool ---
+// Thread-safe, memory-bounded pool of distinct routes seen during the search, keyed by
+// customer set (only the cheapest sequence of a set is kept). When full, the 10% of
+// routes with the highest cost per customer are evicted. recombine() assembles a new
+// solution from pooled routes by beam search over a set-partitioning model: states
+// cover customers in id order, either with a disjoint pooled route holding the next
+// uncovered customer or by leaving it for the cheapest-insertion repair step.
+class RoutePool {
+public:
+    size_t capacity = 5000;
+    int beamWidth = 20;
+
+    void add(const ProblemData& data, const Solution& sol) {
+        std::lock_guard<std::mutex> lock(m);
+        for (const auto& r : sol.routes) {
+            if (r.customers.empty()) continue;
+            uint64_t sig = RouteCostCache::signature(r.customers);
+            double cost = routeDistance(data, r.customers);
+            auto it = index.find(sig);
+            if (it != index.end()) {
+                PooledRoute& pr = routes[it->second];
+                if (sameSet(pr, r) && cost < pr.cost - 1e-9) {
+                    pr.cost = cost;
+                    for (size_t k = 0; k < r.customers.size(); ++k) pr.ids[k] = r.customers[k];
+                }
+                continue;
+            }
+            PooledRoute pr{sig, {}, cost, r.currentLoad};
+            for (NodeId c : r.customers) pr.ids.push_back(c);
+            index[sig] = routes.size();
+            routes.push_back(std::move(pr));
+        }
+        if (routes.size() > capacity) evict();
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(m);
+        return routes.size();
+    }
+
+    // Returns false if the pool is empty, the deadline passed before the beam finished or the
+    // fleet had no vehicle for a route the repair step needed (out is then incomplete)
+    bool recombine(const ProblemData& data, Solution& out, Clock::time_point deadline) {
+        std::vector<PooledRoute> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            snapshot = routes;
+        }
+        int n = data.customers.size();
+        if (snapshot.empty()) return false;
+        std::vector<std::vector<int>> routesOf(n + 1);
+        std::vector<double> estimate(n + 1, std::numeric_limits<double>::infinity());
+        for (size_t r = 0; r < snapshot.size(); ++r) {
+            double perCustomer = snapshot[r].cost / snapshot[r].ids.size();
+            for (int id : snapshot[r].ids) {
+                routesOf[id].push_back(r);
+                estimate[id] = std::min(estimate[id], perCustomer);
+            }
+        }
+        for (int id = 1; id <= n; ++id)
+            if (routesOf[id].empty()) estimate[id] = 2 * data.getDistance(data.depot.id, id);
+
+        // heavy counts the chosen routes per capacity level, so the beam keeps to partitions
+        // that the fleet can give one vehicle per route (Hall's condition)
+        struct State { std::vector<char> covered; std::vector<int> chosen, heavy; double cost, score; int next; };
+        State root{std::vector<char>(n + 1, 0), {}, std::vector<int>(data.levelCapacity.size(), 0), 0.0, 0.0, 1};
+        for (int id = 1; id <= n; ++id) root.score += estimate[id];
+        std::vector<State> beam{root}, children;
+        const double skipPenalty = 1.5; // a customer left to the repair step costs more than its estimate
+        while (true) {
+            if (Clock::now() >= deadline) return false;
+            children.clear();
+            bool expanded = false;
+            for (auto& st : beam) {
+                while (st.next <= n && st.covered[st.next]) ++st.next;
+                if (st.next > n) { children.push_back(st); continue; }
+                expanded = true;
+                int c = st.next;
+                for (int r : routesOf[c]) {
+                    const auto& ids = snapshot[r].ids;
+                    if (std::any_of(ids.begin(), ids.end(), [&](int id) { return st.covered[id]; })) continue;
+                    bool fits = true;
+                    for (size_t k = 0; k < st.heavy.size() && fits; ++k)
+                        fits = st.heavy[k] + data.heavyAt(snapshot[r].load, k) <= data.levelVehicles[k];
+                    if (!fits) continue;
+                    State child = st;
+                    data.addToLevels(child.heavy, snapshot[r].load);
+                    for (int id : ids) { child.covered[id] = 1; child.score -= estimate[id]; }
+                    child.chosen.push_back(r);
+                    child.cost += snapshot[r].cost;
+                    child.score += snapshot[r].cost;
+                    children.push_back(std::move(child));
+                }
+                State skip = st;
+                skip.covered[c] = 1;
+                skip.score += (skipPenalty - 1.0) * estimate[c];
+                skip.cost += skipPenalty * estimate[c];
+                children.push_back(std::move(skip));
+            }
+            size_t keep = std::min<size_t>(beamWidth, children.size());
+            std::partial_sort(children.begin(), children.begin() + keep, children.end(),
+                              [](const State& a, const State& b) { return a.score < b.score; });
+            children.resize(keep);
+            beam.swap(children);
+            if (!expanded) break;
+        }
+
+        // Rebuild the chosen routes and repair the customers left out
+        const State& best = beam.front();
+        out.routes.clear();
+        std::vector<char> placed(n + 1, 0);
+        for (int r : best.chosen) {
+            Route route;
+            for (int id : snapshot[r].ids) { route.customers.push_back(id); placed[id] = 1; }
+            route.currentLoad = snapshot[r].load;
+            out.routes.push_back(route);
+        }
+        out.calculateTotalCost(data);
+        assignVehicles(data, out);
+        for (int id = 1; id <= n; ++id)
+            if (!placed[id] && !insertCheapest(data, out, id)) return false;
+        return true;
+    }
+
+private:
+    struct PooledRoute { uint64_t sig; std::vector<int> ids; double cost; int load; };
+    std::mutex m;
+    std::vector<PooledRoute> routes;
+    std::unordered_map<uint64_t, size_t> index;
+
+    static bool sameSet(const PooledRoute& pr, const Route& r) {
+        if (pr.ids.size() != r.customers.size()) return false;
+        for (const auto& c : r.customers)
+            if (std::find(pr.ids.begin(), pr.ids.end(), c) == pr.ids.end()) return false;
+        return true;
+    }
+
+    void evict() {
+        size_t keep = capacity - capacity / 10;
+        std::nth_element(routes.begin(), routes.begin() + keep, routes.end(),
+                         [](const PooledRoute& a, const PooledRoute& b) {
+                             return a.cost / a.ids.size() < b.cost / b.ids.size();
+                         });
+        routes.resize(keep);
+        index.clear();
+        for (size_t k = 0; k < routes.size(); ++k) index[routes[k].sig] = k;
+    }
+};
+
+// --- Route Minimization ---
+// Ejection-pool route elimination (after Nagata and Braysy) for the fleet-limit mode. Until
+// Hall's condition holds, the lightest route heavy at the first capacity level that breaks
+// it is dissolved into a pool of customers. The remaining routes then get vehicles of their
+// own and the customers are taken back last in first out: each goes to its cheapest
+// feasible position or, failing that, replaces the customer with the lowest ejection count
+// whose removal makes room, and that customer joins the pool. Counts grow for customers
+// that force ejections, which steers the search out of cycles. An attempt that runs out
+// of ejections or time is rolled back.
+class RouteMinimizer {
+public:
+    long maxEjectionsPerRoute = 20000;
+
+    RouteMinimizer(const ProblemData& d) : data(d) {}
+
+    // Remove routes until the fleet can give each one a vehicle of its own, and assign them;
+    // false if the deadline or the ejection budget stopped it first
+    bool run(Solution& sol, Clock::time_point deadline) {
+        Clock::time_point t0 = Clock::now();
+        ejectionCount.assign(data.customers.size() + 1, 1);
+        removed = 0;
+        ejections = 0;
+        sol.dropEmptyRoutes();
+        bool fits = assignVehicles(data, sol);
+        if (!fits && Clock::now() < deadline && removeRoutes(sol, deadline)) fits = assignVehicles(data, sol);
+        elapsed = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        return fits;
+    }
+
+    int routesRemoved() const { return removed; }
+    long ejectionCountTotal() const { return ejections; }
+    double elapsedMs() const { return elapsed; }
+
+private:
+    const ProblemData& data;
+    std::vector<int> ejectionCount, levelCount;
+    std::vector<NodeId> pool;
+    Solution saved;
+    RouteSegments segments;
+    int removed = 0;
+    long ejections = 0;
+    double elapsed = 0.0;
+
+    bool removeRoutes(Solution& sol, Clock::time_point deadline) {
+        saved.assign(sol);
+        pool.clear();
+        levelCount.assign(data.levelCapacity.size(), 0);
+        for (const auto& r : sol.routes) data.addToLevels(levelCount, r.currentLoad);
+        int victims = 0;
+        while (!data.levelsFit(levelCount)) {
+            size_t k = 0;
+            while (levelCount[k] <= data.levelVehicles[k]) ++k;
+            size_t victim = sol.routes.size();
+            for (size_t r = 0; r < sol.routes.size(); ++r) {
+                const Route& a = sol.routes[r];
+                if (a.customers.empty() || !data.heavyAt(a.currentLoad, k)) continue;
+                if (victim == sol.routes.size()) { victim = r; continue; }
+                const Route& b = sol.routes[victim];
+                if (a.currentLoad < b.currentLoad || (a.currentLoad == b.currentLoad && a.totalDistance < b.totalDistance)) victim = r;
+            }
+            data.addToLevels(levelCount, sol.routes[victim].currentLoad, -1);
+            while (!sol.routes[victim].customers.empty())
+                pool.push_back(sol.removeCustomer(data, victim, sol.routes[victim].customers.size() - 1));
+            ++victims;
+        }
+        sol.dropEmptyRoutes();
+        assignVehicles(data, sol); // one vehicle per route now, so insertions check real capacities
+        segments.reset();
+
+        long budget = maxEjectionsPerRoute * victims;
+        while (!pool.empty()) {
+            if (budget-- <= 0 || Clock::now() >= deadline) return rollback(sol);
+            NodeId v = pool.back();
+            pool.pop_back();
+            if (insertCheapest(data, sol, v, false, &segments)) continue;
+            if (!ejectFor(sol, v)) return rollback(sol);
+            ++ejectionCount[v];
+            ++ejections;
+        }
+        removed = victims;
+        return true;
+    }
+
+    bool rollback(Solution& sol) {
+        sol.assign(saved);
+        segments.reset();
+        return false;
+    }
+
+    // Put v in place of the customer with the lowest ejection count (then the cheapest
+    // replacement) whose removal makes room for it; the ejected customer joins the pool
+    bool ejectFor(Solution& sol, NodeId v) {
+        size_t bestRoute = sol.routes.size(), bestPos = 0;
+        int bestCount = INT_MAX;
+        double bestCost = std::numeric_limits<double>::infinity();
+        for (size_t r = 0; r < sol.routes.size(); ++r) {
+            const Route& route = sol.routes[r];
+            int capacity = data.vehicles[route.vehicleId].capacity;
+            for (size_t i = 0; i < route.customers.size(); ++i) {
+                NodeId k = route.customers[i];
+                if (route.currentLoad - data.demand(k) + data.demand(v) > capacity || ejectionCount[k] > bestCount) continue;
+                int p = i == 0 ? data.depot.id : route.customers[i - 1];
+                int q = i + 1 == route.customers.size() ? data.depot.id : route.customers[i + 1];
+                double cost = data.getDistance(p, v) + data.getDistance(v, q) - data.getDistance(p, k) - data.getDistance(k, q);
+                if (ejectionCount[k] == bestCount && cost >= bestCost) continue;
+                if (!data.feasible(segments.withReplacement(data, r, route, i, v), capacity)) continue;
+                bestRoute = r; bestPos = i; bestCount = ejectionCount[k]; bestCost = cost;
+            }
+        }
+        if (bestRoute == sol.routes.size()) return false;
+        pool.push_back(sol.removeCustomer(data, bestRoute, bestPos));
+        sol.insertCustomer(data, bestRoute, bestPos, v);
+        segments.touch(bestRoute);
+        return true;
+    }
+};
+
+// --- Anytime Optimization Driver ---
+// Iterated local search: perturb the current solution by removing a few random
+// customers and reinserting them at their cheapest feasible position, then run
+// the local search. Stops at the wall-clock deadline or the iteration cap, keeps
+// the best solution and records a (time, cost) point at every improvement.
+class AnytimeSolver {
+public:
+    struct TracePoint { double ms; double cost; };
+
+    double timeLimitMs = 200.0;
+    long maxIterations = LONG_MAX;
+    int perturbSize = 4;
+    double acceptThreshold = 0.005; // accept candidates up to 0.5% worse than the best
+    RoutePool* routePool = nullptr;  // collects local optima and recombines them when set
+    long recombineInterval = 100;
+    double lowerBound = 0.0;         // stop once (best - lowerBound) / best <= targetGap
+    double targetGap = 0.01;
+
+    AnytimeSolver(const ProblemData& d, std::mt19937& g) : data(d), gen(g), ls(d) {}
+
+    Solution run(const Solution& start) {
+        Clock::time_point deadline = begin(start);
+        while (iterations < maxIterations && Clock::now() < deadline) {
+            if (lowerBound > 0.0 && best.totalCost - lowerBound <= targetGap * best.totalCost) break;
+            step(deadline);
+        }
+        return best;
+    }
+
+    // Start a search from start and return its deadline; run() is begin() plus step() calls
+    Clock::time_point begin(const Solution& start) {
+        t0 = Clock::now();
+        Clock::time_point deadline = t0 + std::chrono::duration_cast<Clock::duration>(
+                                              std::chrono::duration<double, std::milli>(timeLimitMs));
+        trace.clear();
+        trace.reserve(1024);
+        iterations = 0;
+        current.assign(start);
+        current.reserveBuffers(data);
+        ls.run(current, deadline);
+        best.assign(current);
+        best.reserveBuffers(data);
+        record();
+        return deadline;
+    }
+
+    // One perturbation and local search. Candidate, current and best keep their route
+    // buffers between steps, so without a route pool a step does not touch the heap
+    void step(Clock::time_point deadline) {
+        ++iterations;
+        candidate.assign(current);
+        candidate.reserveBuffers(data);
+        if (perturb(candidate)) {
+            ls.run(candidate, deadline);
+            if (routePool) routePool->add(data, candidate);
+            if (candidate.totalCost < best.totalCost - 1e-9) { best.assign(candidate); record(); }
+            if (candidate.totalCost < best.totalCost * (1.0 + acceptThreshold)) current.assign(candidate);
+            else current.assign(best);
+        }
+
+        if (routePool && iterations % recombineInterval == 0 && routePool->recombine(data, candidate, deadline)) {
+            ls.run(candidate, deadline);
+            if (candidate.totalCost < best.totalCost - 1e-9) { best.assign(candidate); current.assign(candidate); record(); }
+        }
+    }
+
+    const Solution& bestSolution() const { return best; }
+    const std::vector<TracePoint>& improvementTrace() const { return trace; }
+    long iterationCount() const { return iterations; }
+
+private:
+    const ProblemData& data;
+    std::mt19937& gen;
+    LocalSearch ls;
+    Solution best, current, candidate;
+    std::vector<NodeId> removed;
+    std::vector<TracePoint> trace;
+    Clock::time_point t0;
+    long iterations = 0;
+
+    void record() {
+        trace.push_back({std::chrono::duration<double, std::milli>(Clock::now() - t0).count(), best.totalCost});
+    }
+
+    // Returns false if a removed customer could not be put back (no vehicle left for a new route)
+    bool perturb(Solution& sol) {
+        removed.clear();
+        for (int k = 0; k < perturbSize && !sol.routes.empty(); ++k) {
+            size_t r = gen() % sol.routes.size();
+            if (sol.routes[r].customers.empty()) continue;
+            removed.push_back(sol.removeCustomer(data, r, gen() % sol.routes[r].customers.size()));
+        }
+        std::shuffle(removed.begin(), removed.end(), gen);
+        for (NodeId c : removed)
+            if (!insertCheapest(data, sol, c)) return false;
+        return true;
+    }
+};
+
+// --- Simulated Annealing ---
+// Random relocate, swap and intra-route 2-opt moves over flat id sequences with
+// O(1) delta evaluation. Route buffers are reserved up front, so the acceptance
+// loop never allocates. With replicas > 1 it runs parallel tempering: one replica
+// per temperature of a geometric ladder, annealed concurrently on the pool, with
+// Metropolis exchanges between neighbouring temperatures every exchangeInterval.
+class SimulatedAnnealing {
+public:
+    enum class Cooling { Geometric, Linear, LundyMees };
+
+    Cooling cooling = Cooling::Geometric;
+    long iterations = 5000000;        // per replica
+    double initialTemperature = 0.0;  // 0 calibrates it from sampled uphill moves
+    double finalTemperature = 0.01;
+    double timeLimitMs = 0.0;         // 0 means no time limit
+    int replicas = 1;
+    long exchangeInterval = 20000;
+
+    SimulatedAnnealing(const ProblemData& d, std::mt19937& g, ThreadPool* p = nullptr) : data(d), gen(g), pool(p) {}
+
+    Solution run(const Solution& start) {
+        deadline = timeLimitMs > 0 ? Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                                        std::chrono::duration<double, std::milli>(timeLimitMs))
+                                   : Clock::time_point::max();
+        int numReplicas = std::max(1, replicas);
+        std::vector<State> states(numReplicas);
+        for (auto& st : states) init(st, start);
+        double t0 = initialTemperature > 0 ? initialTemperature : calibrate(states[0]);
+        double t1 = std::min(finalTemperature, t0);
+
+        if (numReplicas == 1) {
+            anneal(states[0], iterations, t0, t1, true);
+        } else {
+            std::vector<double> ladder(numReplicas);
+            for (int k = 0; k < numReplicas; ++k) ladder[k] = t1 * std::pow(t0 / t1, (double)k / (numReplicas - 1));
+            for (long done = 0; done < iterations && Clock::now() < deadline; done += exchangeInterval) {
+                long steps = std::min(exchangeInterval, iterations - done);
+                ThreadPool::TaskGroup group;
+                for (int k = 0; k < numReplicas; ++k) {
+                    auto task = [this, &states, &ladder, k, steps] { anneal(states[k], steps, ladder[k], ladder[k], false); };
+                    if (pool) pool->submit(task, &group); else task();
+                }
+                if (pool) pool->wait(group);
+                for (int k = 0; k + 1 < numReplicas; ++k) {
+                    double x = (states[k].cost - states[k + 1].cost) * (1.0 / ladder[k] - 1.0 / ladder[k + 1]);
+                    if (x >= 0 || uniform(gen) < std::exp(x)) std::swap(states[k], states[k + 1]);
+                }
+            }
+        }
+
+        accepted = 0;
+        const State* best = &states[0];
+        for (const auto& st : states) {
+            accepted += st.accepted;
+            if (st.bestCost < best->bestCost) best = &st;
+        }
+        Solution sol;
+        for (size_t r = 0; r < best->bestSeq.size(); ++r) {
+            if (best->bestSeq[r].empty()) continue;
+            Route route(vehicleOf[r]);
+            for (int id : best->bestSeq[r]) {
+                route.customers.push_back(id);
+                route.currentLoad += data.demand(id);
+            }
+            sol.routes.push_back(route);
+        }
+        sol.calculateTotalCost(data);
+        return sol;
+    }
+
+    long acceptedMoves() const { return accepted; }
+
+private:
+    struct State {
+        std::vector<std::vector<int>> seq, bestSeq;
+        std::vector<int> load;
+        double cost = 0.0, bestCost = 0.0;
+        std::mt19937 rng;
+        long accepted = 0;
+    };
+    struct Move { int type, a, i, b, j; double delta; };
+
+    const ProblemData& data;
+    std::mt19937& gen;
+    ThreadPool* pool;
+    std::vector<int> vehicleOf;
+    Clock::time_point deadline;
+    long accepted = 0;
+
+    static double uniform(std::mt19937& rng) { return (rng() >> 8) * (1.0 / 16777216.0); }
+
+    void init(State& st, const Solution& start) {
+        size_t n = data.customers.size();
+        vehicleOf.clear();
+        st.seq.assign(start.routes.size(), {});
+        st.load.assign(start.routes.size(), 0);
+        for (size_t r = 0; r < start.routes.size(); ++r) {
+            vehicleOf.push_back(start.routes[r].vehicleId);
+            st.seq[r].reserve(n);
+            for (NodeId c : start.routes[r].customers) st.seq[r].push_back(c);
+            st.load[r] = start.routes[r].currentLoad;
+        }
+        st.bestSeq = st.seq;
+        for (auto& b : st.bestSeq) b.reserve(n);
+        st.cost = st.bestCost = start.totalCost;
+        st.rng.seed(gen());
+        st.accepted = 0;
+    }
+
+    int at(const std::vector<int>& r, int k) const {
+        return (k < 0 || k >= (int)r.size()) ? data.depot.id : r[k];
+    }
+    double d(int a, int b) const { return data.getDistance(a, b); }
+
+    // Draw a random feasible move and its cost delta; type -1 means no move
+    Move propose(State& st) const {
+        int numRoutes = st.seq.size();
+        Move m{(int)(st.rng() % 3), (int)(st.rng() % numRoutes), 0, (int)(st.rng() % numRoutes), 0, 0.0};
+        const auto& A = st.seq[m.a];
+        const auto& B = st.seq[m.b];
+        if (A.empty()) return {-1, 0, 0, 0, 0, 0.0};
+        m.i = st.rng() % A.size();
+        int u = A[m.i];
+        if (m.type == 0) { // relocate u before position j of B
+            m.j = st.rng() % (B.size() + 1);
+            if (m.a == m.b && (m.j == m.i || m.j == m.i + 1)) return {-1, 0, 0, 0, 0, 0.0};
+            if (m.a != m.b && st.load[m.b] + data.demand(u) > data.vehicles[vehicleOf[m.b]].capacity)
+                return {-1, 0, 0, 0, 0, 0.0};
+            int p = at(A, m.i - 1), q = at(A, m.i + 1);
+            m.delta = d(at(B, m.j - 1), u) + d(u, at(B, m.j)) - d(at(B, m.j - 1), at(B, m.j)) -
+                      (d(p, u) + d(u, q) - d(p, q));
+        } else if (m.type == 1) { // swap u with B[j] in another route
+            if (m.a == m.b || B.empty()) return {-1, 0, 0, 0, 0, 0.0};
+            m.j = st.rng() % B.size();
+            int v = B[m.j], shift = data.demand(v) - data.demand(u);
+            if (st.load[m.a] + shift > data.vehicles[vehicleOf[m.a]].capacity ||
+                st.load[m.b] - shift > data.vehicles[vehicleOf[m.b]].capacity) return {-1, 0, 0, 0, 0, 0.0};
+            int pa = at(A, m.i - 1), na = at(A, m.i + 1), pb = at(B, m.j - 1), nb = at(B, m.j + 1);
+            m.delta = d(pa, v) + d(v, na) - d(pa, u) - d(u, na) + d(pb, u) + d(u, nb) - d(pb, v) - d(v, nb);
+        } else { // reverse A[i..j]
+            m.b = m.a;
+            m.j = st.rng() % A.size();
+            if (m.i == m.j) return {-1, 0, 0, 0, 0, 0.0};
+            if (m.i > m.j) std::swap(m.i, m.j);
+            int p = at(A, m.i - 1), q = at(A, m.j + 1);
+            m.delta = d(p, A[m.j]) + d(A[m.i], q) - d(p, A[m.i]) - d(A[m.j], q);
+        }
+        return m;
+    }
+
+    void apply(State& st, const Move& m) const {
+        auto& A = st.seq[m.a];
+        auto& B = st.seq[m.b];
+        if (m.type == 0) {
+            int u = A[m.i];
+            A.erase(A.begin() + m.i);
+            B.insert(B.begin() + (m.a == m.b && m.j > m.i ? m.j - 1 : m.j), u);
+            st.load[m.a] -= data.demand(u);
+            st.load[m.b] += data.demand(u);
+        } else if (m.type == 1) {
+            int shift = data.demand(B[m.j]) - data.demand(A[m.i]);
+            std::swap(A[m.i], B[m.j]);
+            st.load[m.a] += shift;
+            st.load[m.b] -= shift;
+        } else {
+            std::reverse(A.begin() + m.i, A.begin() + m.j + 1);
+        }
+        st.cost += m.delta;
+    }
+
+    double calibrate(State& st) const {
+        double sum = 0.0; int count = 0;
+        for (int k = 0; k < 2000; ++k) {
+            Move m = propose(st);
+            if (m.type >= 0 && m.delta > 0) { sum += m.delta; ++count; }
+        }
+        // Start where an average uphill move is accepted 1% of the time
+        return count ? (sum / count) / std::log(100.0) : 1.0;
+    }
+
+    void anneal(State& st, long steps, double t0, double t1, bool cool) const {
+        double temp = t0;
+        double alpha = std::pow(t1 / t0, 1.0 / std::max(1L, steps));
+        double beta = (t0 - t1) / (std::max(1L, steps) * t0 * t1);
+        for (long k = 0; k < steps; ++k) {
+            if ((k & 4095) == 0 && Clock::now() >= deadline) break;
+            Move m = propose(st);
+            if (m.type >= 0 && (m.delta <= 0 || uniform(st.rng) < std::exp(-m.delta / temp))) {
+                apply(st, m);
+                ++st.accepted;
+                if (st.cost < st.bestCost - 1e-9) {
+                    st.bestCost = st.cost;
+                    for (size_t r = 0; r < st.seq.size(); ++r) st.bestSeq[r].assign(st.seq[r].begin(), st.seq[r].end());
+                }
+            }
+            if (!cool) continue;
+            if (cooling == Cooling::Geometric) temp *= alpha;
+            else if (cooling == Cooling::Linear) temp = t0 - (t0 - t1) * (double)(k + 1) / steps;
+            else temp = temp / (1.0 + beta * temp);
+        }
+    }
+};
+
+// --- Ruin-and-Recreate Large Neighbourhood Search ---
+// Each iteration removes customers with one destroy operator (random, radial by
+// coordinates, whole routes, or strings around a seed) and reinserts them with
+// greedy or regret-k insertion, skipping positions at the blink rate. The best
+// insertion of every removed customer into every route is cached and only the
+// routes touched by the last insertion are re-evaluated. Candidates are accepted
+// with a simulated-annealing criterion whose temperature decays geometrically.
+class LNS {
+public:
+    enum class Destroy { Random, Radial, Route, String };
+    enum class Repair { Greedy, Regret };
+    static const int kDestroyOps = 4, kRepairOps = 2;
+
+    long iterations = 5000;
+    double timeLimitMs = 0.0; // 0 means no time limit
+    int minRemove = 5, maxRemove = 30;
+    int regretK = 3;
+    double blinkRate = 0.01;
+    int maxStringLength = 10;
+    double startTemperature = 10.0, endTemperature = 0.5;
+
+    LNS(const ProblemData& d, std::mt19937& g) : data(d), gen(g) {
+        size_t n = data.customers.size();
+        closest.resize(n * n);
+        for (size_t i = 0; i < n; ++i) {
+            auto first = closest.begin() + i * n;
+            for (size_t j = 0; j < n; ++j) first[j] = j;
+            const Customer& c = data.customers[i];
+            std::sort(first, first + n, [&](int a, int b) {
+                const Customer &ca = data.customers[a], &cb = data.customers[b];
+                return std::hypot(ca.x - c.x, ca.y - c.y) < std::hypot(cb.x - c.x, cb.y - c.y);
+            });
+        }
+    }
+
+    Solution run(const Solution& start) {
+        Clock::time_point t0 = Clock::now();
+        Clock::time_point deadline = timeLimitMs > 0 ? t0 + std::chrono::duration_cast<Clock::duration>(
+                                                                std::chrono::duration<double, std::milli>(timeLimitMs))
+                                                     : Clock::time_point::max();
+        Solution current = start, best = start;
+        double temp = startTemperature;
+        double alpha = std::pow(endTemperature / startTemperature, 1.0 / std::max(1L, iterations));
+        for (done = 0; done < iterations && Clock::now() < deadline; ++done, temp *= alpha) {
+            Solution candidate = current;
+            if (!iterate(candidate, (Destroy)(gen() % kDestroyOps), (Repair)(gen() % kRepairOps))) continue;
+            if (candidate.totalCost < current.totalCost - temp * std::log(uniform())) current = candidate;
+            if (current.totalCost < best.totalCost - 1e-9) best = current;
+        }
+        elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        return best;
+    }
+
+    // One ruin-and-recreate step applied to sol in place. Returns false if the repair needed a
+    // new route the fleet has no vehicle for; sol then misses customers and must be dropped.
+    bool iterate(Solution& sol, Destroy d, Repair r) {
+        destroy(sol, d);
+        bool complete = repair(sol, r);
+        sol.calculateTotalCost(data);
+        return complete;
+    }
+
+    // Build a solution from scratch by inserting every customer with the given repair
+    Solution construct(Repair r) {
+        Solution sol;
+        removed.clear();
+        for (const auto& c : data.customers) removed.push_back(c.id);
+        if (!repair(sol, r)) throw std::runtime_error("The fleet has too few vehicles for the insertion's routes");
+        sol.calculateTotalCost(data);
+        return sol;
+    }
+
+    long iterationCount() const { return done; }
+    double iterationsPerSecond() const { return elapsedMs > 0 ? done * 1000.0 / elapsedMs : 0.0; }
+
+private:
+    struct Insertion { double cost; int pos; };
+
+    const ProblemData& data;
+    std::mt19937& gen;
+    std::vector<int> closest;              // customers sorted by Euclidean distance, n per customer
+    std::vector<int> removed;              // customer ids waiting for reinsertion
+    std::vector<Insertion> cache;          // best insertion of removed[k] into route r at k * numRoutes + r
+    std::vector<std::pair<int, int>> where; // (route, position) by customer index
+    std::vector<char> ruined;
+    long done = 0;
+    double elapsedMs = 0.0;
+
+    double uniform() { return (gen() >> 8) * (1.0 / 16777216.0) + 1e-12; }
+
+    void locate(const Solution& sol) {
+        where.assign(data.customers.size(), {-1, -1});
+        for (size_t r = 0; r < sol.routes.size(); ++r)
+            for (size_t k = 0; k < sol.routes[r].customers.size(); ++k)
+                where[sol.routes[r].customers[k] - 1] = {(int)r, (int)k};
+    }
+
+    void removeAt(Solution& sol, int r, int pos) {
+        Route& route = sol.routes[r];
+        int id = route.customers[pos];
+        removed.push_back(id);
+        route.currentLoad -= data.demand(id);
+        route.customers.erase(route.customers.begin() + pos);
+        route.version = 0;
+        for (size_t k = pos; k < route.customers.size(); ++k) where[route.customers[k] - 1].second = k;
+        where[id - 1] = {-1, -1};
+    }
+
+    void destroy(Solution& sol, Destroy op) {
+        int n = data.customers.size();
+        int target = std::min(n, minRemove + (int)(gen() % (maxRemove - minRemove + 1)));
+        removed.clear();
+        locate(sol);
+        int seed = gen() % n;
+        const int* near = &closest[(size_t)seed * n];
+        if (op == Destroy::Random) {
+            while ((int)removed.size() < target) {
+                auto [r, pos] = where[gen() % n];
+                if (r >= 0) removeAt(sol, r, pos);
+            }
+        } else if (op == Destroy::Radial) {
+            for (int k = 0; k < n && (int)removed.size() < target; ++k) {
+                auto [r, pos] = where[near[k]];
+                removeAt(sol, r, pos);
+            }
+        } else if (op == Destroy::Route) {
+            for (int k = 0; k < n && (int)removed.size() < target; ++k) {
+                int r = where[near[k]].first;
+                while (r >= 0 && !sol.routes[r].customers.empty()) removeAt(sol, r, sol.routes[r].customers.size() - 1);
+            }
+        } else {
+            // Remove one string of consecutive customers from each route met around the seed
+            ruined.assign(sol.routes.size(), 0);
+            for (int k = 0; k < n && (int)removed.size() < target; ++k) {
+                auto [r, pos] = where[near[k]];
+                if (r < 0 || ruined[r]) continue;
+                ruined[r] = 1;
+                int size = sol.routes[r].customers.size();
+                int len = 1 + gen() % std::min({size, maxStringLength, target - (int)removed.size()});
+                int first = std::max(0, std::min(pos - (int)(gen() % len), size - len));
+                for (int j = 0; j < len; ++j) removeAt(sol, r, first);
+            }
+        }
+        sol.routes.erase(std::remove_if(sol.routes.begin(), sol.routes.end(),
+                                        [](const Route& rt) { return rt.customers.empty(); }), sol.routes.end());
+    }
+
+    Insertion bestInsertion(const Route& route, int id) {
+        Insertion best{std::numeric_limits<double>::infinity(), -1};
+        if (route.currentLoad + data.demand(id) > data.vehicles[route.vehicleId].capacity) return best;
+        int prev = data.depot.id;
+        for (size_t j = 0; j <= route.customers.size(); ++j) {
+            int next = j == route.customers.size() ? data.depot.id : route.customers[j];
+            if (uniform() >= blinkRate) {
+                double cost = data.getDistance(prev, id) + data.getDistance(id, next) - data.getDistance(prev, next);
+                if (cost < best.cost) best = {cost, (int)j};
+            }
+            prev = next;
+        }
+        return best;
+    }
+
+    bool repair(Solution& sol, Repair op) {
+        std::shuffle(removed.begin(), removed.end(), gen);
+        size_t numRoutes = sol.routes.size();
+        cache.resize(removed.size() * numRoutes);
+        for (size_t k = 0; k < removed.size(); ++k)
+            for (size_t r = 0; r < numRoutes; ++r) cache[k * numRoutes + r] = bestInsertion(sol.routes[r], removed[k]);
+
+        const double inf = std::numeric_limits<double>::infinity();
+        while (!removed.empty()) {
+            // Pick the customer to insert: cheapest (greedy) or largest regret
+            int pick = -1, pickRoute = -1;
+            double pickScore = -inf, pickCost = inf;
+            for (size_t k = 0; k < removed.size(); ++k) {
+                double c1 = inf, ck[8];
+                int bestRoute = -1, kk = std::max(2, std::min(regretK, 8));
+                for (int h = 0; h < kk; ++h) ck[h] = inf;
+                for (size_t r = 0; r < numRoutes; ++r) {
+                    double c = cache[k * numRoutes + r].cost;
+                    if (c < c1) { c1 = c; bestRoute = r; }
+                    if (op == Repair::Regret && c < ck[kk - 1]) {
+                        int h = kk - 1;
+                        for (; h > 0 && ck[h - 1] > c; --h) ck[h] = ck[h - 1];
+                        ck[h] = c;
+                    }
+                }
+                double score;
+                if (bestRoute < 0) score = inf; // no feasible route: must open one first
+                else if (op == Repair::Greedy) score = -c1;
+                else {
+                    score = 0.0;
+                    for (int h = 1; h < kk; ++h) score += (ck[h] == inf ? 1e9 : ck[h] - c1);
+                }
+                if (score > pickScore || (score == pickScore && c1 < pickCost)) {
+                    pick = k; pickRoute = bestRoute; pickScore = score; pickCost = c1;
+                }
+            }
+
+            int id = removed[pick];
+            if (pickRoute < 0) {
+                // No feasible insertion: open a new route, if the fleet has a vehicle for it.
+                // Opening may move routes to other vehicles, so every cached insertion is redone.
+                if (!openFleetRoute(data, sol, data.demand(id))) return false;
+                pickRoute = numRoutes++;
+                cache.resize(removed.size() * numRoutes);
+                for (size_t k = 0; k < removed.size(); ++k)
+                    for (size_t r = 0; r < numRoutes; ++r)
+                        cache[k * numRoutes + r] = bestInsertion(sol.routes[r], removed[k]);
+                cache[pick * numRoutes + pickRoute] = {2 * data.getDistance(data.depot.id, id), 0};
+            }
+            Route& route = sol.routes[pickRoute];
+            route.customers.insert(route.customers.begin() + cache[pick * numRoutes + pickRoute].pos, id);
+            route.currentLoad += data.demand(id);
+            route.version = 0;
+
+            // Drop the inserted customer and refresh only the touched route
+            removed[pick] = removed.back();
+            removed.pop_back();
+            for (size_t r = 0; r < numRoutes; ++r) cache[pick * numRoutes + r] = cache[removed.size() * numRoutes + r];
+            for (size_t k = 0; k < removed.size(); ++k)
+                cache[k * numRoutes + pickRoute] = bestInsertion(route, removed[k]);
+        }
+        return true;
+    }
+};
+
+// --- Solution Snapshots ---
+// Immutable copy-on-write view of a solution. Routes are reference counted and shared
+// between snapshots: building one against a previous snapshot copies only the routes
+// that changed. A route whose version is still indexed by the previous snapshot is
+// shared in O(1); an edited route is looked up by set signature and confirmed by
+// comparing sequences, so a route that was changed and changed back is shared too.
+class SolutionSnapshot {
+public:
+    using RoutePtr = std::shared_ptr<const Route>;
+
+    SolutionSnapshot() = default;
+
+    // Routes of sol are stamped with the version of the snapshot route they match
+    SolutionSnapshot(Solution& sol, const SolutionSnapshot* previous = nullptr)
+        : cost(sol.totalCost), fingerprint(sol.fingerprint) {
+        routes.reserve(sol.routes.size());
+        signatures.reserve(sol.routes.size());
+        byVersion.reserve(sol.routes.size());
+        bySignature.reserve(sol.routes.size());
+        for (auto& r : sol.routes) {
+            size_t k = previous ? previous->findVersion(r) : kNone;
+            uint64_t sig = k != kNone ? previous->signatures[k] : RouteCostCache::signature(r.customers);
+            if (k == kNone && previous) k = previous->findSignature(r, sig);
+            if (k != kNone) {
+                ++reused;
+                routes.push_back(previous->routes[k]);
+            } else {
+                if (!r.version) r.version = Route::newVersion();
+                routes.push_back(std::make_shared<const Route>(r));
+            }
+            r.version = routes.back()->version;
+            signatures.push_back(sig);
+            byVersion.emplace(r.version, routes.size() - 1);
+            bySignature.emplace(sig, routes.size() - 1);
+        }
+    }
+
+    double totalCost() const { return cost; }
+    const std::vector<RoutePtr>& sharedRoutes() const { return routes; }
+    size_t reusedRoutes() const { return reused; } // routes shared with the previous snapshot
+
+    // Copy into a mutable solution, reusing out's route buffers and skipping routes out
+    // already holds at the same index
+    void materialize(Solution& out) const {
+        out.routes.resize(routes.size());
+        for (size_t r = 0; r < routes.size(); ++r) {
+            if (out.routes[r].version == routes[r]->version) {
+                Solution::checkSameRoute(out.routes[r], *routes[r]);
+                continue;
+            }
+            out.routes[r] = *routes[r];
+        }
+        out.totalCost = cost;
+        out.fingerprint = fingerprint;
+    }
+
+private:
+    static constexpr size_t kNone = SIZE_MAX;
+
+    std::vector<RoutePtr> routes;
+    std::vector<uint64_t> signatures;
+    std::unordered_map<uint64_t, size_t> byVersion, bySignature;
+    double cost = 0.0;
+    uint64_t fingerprint = 0;
+    size_t reused = 0;
+
+    size_t findVersion(const Route& r) const {
+        if (!r.version) return kNone;
+        auto it = byVersion.find(r.version);
+        if (it == byVersion.end()) return kNone;
+        Solution::checkSameRoute(r, *routes[it->second]);
+        return it->second;
+    }
+
+    size_t findSignature(const Route& r, uint64_t sig) const {
+        auto it = bySignature.find(sig);
+        if (it == bySignature.end()) return kNone;
+        const Route& cand = *routes[it->second];
+        return cand.vehicleId == r.vehicleId && cand.customers == r.customers ? it->second : kNone;
+    }
+};
+
+// --- Shared Best Solution Register ---
+// Lock-free best-so-far shared by search threads. Publishing swaps in a new entry
+// with a CAS on the head pointer; readers announce the epoch they entered in their
+// own slot, and a replaced entry is freed by its publisher once every announced
+// epoch is newer than the one it was retired in. Each slot must be used by one
+// thread at a time. Entries are snapshots that share unchanged routes with the
+// entry they replace, so a publish copies only the routes that changed.
+class BestSolutionRegister {
+public:
+    explicit BestSolutionRegister(size_t numSlots) : slots(numSlots), retired(numSlots) {
+        for (auto& sl : slots) sl.epoch = kIdle;
+    }
+
+    ~BestSolutionRegister() {
+        delete head.load();
+        for (auto& list : retired)
+            for (auto& r : list) delete r.first;
+    }
+
+    // Publish sol if it beats the current best; returns true if it did
+    bool publish(Solution& sol, size_t slot) {
+        if (sol.totalCost >= bestCost()) return false;
+        enter(slot);
+        Entry* cur = head.load();
+        Entry* e = new Entry{SolutionSnapshot(sol, cur ? &cur->snap : nullptr), ++versionCounter};
+        routesShared += e->snap.reusedRoutes();
+        routesCopied += sol.routes.size() - e->snap.reusedRoutes();
+        while (!cur || sol.totalCost < cur->snap.totalCost()) {
+            if (head.compare_exchange_weak(cur, e)) {
+                cost.store(sol.totalCost);
+                leave(slot);
+                if (cur) retired[slot].push_back({cur, globalEpoch.fetch_add(1)});
+                reclaim(slot);
+                return true;
+            }
+        }
+        leave(slot);
+        delete e;
+        return false;
+    }
+
+    // Copy the best solution into out if it changed since seenVersion
+    bool copyIfNewer(Solution& out, uint64_t& seenVersion, size_t slot) {
+        enter(slot);
+        Entry* cur = head.load();
+        bool newer = cur && cur->version != seenVersion;
+        if (newer) { cur->snap.materialize(out); seenVersion = cur->version; }
+        leave(slot);
+        return newer;
+    }
+
+    double bestCost() const { return cost.load(std::memory_order_relaxed); }
+
+    // Fraction of published routes that were shared with the previous best instead of copied
+    double shareRate() const {
+        size_t total = routesShared + routesCopied;
+        return total ? double(routesShared) / total : 0.0;
+    }
+
+private:
+    static constexpr uint64_t kIdle = UINT64_MAX;
+    struct Entry { SolutionSnapshot snap; uint64_t version; };
+    struct alignas(64) Slot { std::atomic<uint64_t> epoch; };
+
+    std::atomic<Entry*> head{nullptr};
+    std::atomic<uint64_t> globalEpoch{0}, versionCounter{0};
+    std::atomic<double> cost{std::numeric_limits<double>::infinity()};
+    std::atomic<size_t> routesShared{0}, routesCopied{0};
+    std::vector<Slot> slots;
+    std::vector<std::vector<std::pair<Entry*, uint64_t>>> retired; // per slot: entry, retire epoch
+
+    void enter(size_t slot) { slots[slot].epoch.store(globalEpoch.load()); }
+    void leave(size_t slot) { slots[slot].epoch.store(kIdle); }
+
+    void reclaim(size_t slot) {
+        uint64_t oldest = kIdle;
+        for (auto& sl : slots) oldest = std::min(oldest, sl.epoch.load());
+        auto& list = retired[slot];
+        auto keep = std::partition(list.begin(), list.end(), [&](const std::pair<Entry*, uint64_t>& r) {
+            return r.second >= oldest;
+        });
+        for (auto it = keep; it != list.end(); ++it) delete it->first;
+        list.erase(keep, list.end());
+    }
+};
+
+// --- Parallel Adaptive LNS ---
+// Several independent LNS searches advance in chunks of iterations on the
+// work-stealing pool; a finished chunk resubmits itself until the deadline or the
+// iteration cap. Destroy/repair operators are drawn by roulette over weights shared
+// through atomics and updated with the classic 33/9/13 scores. Improvements go to a
+// BestSolutionRegister, and a search that stalls restarts from the shared best.
+class ParallelALNS {
+public:
+    int searches = 0;            // 0 means one per pool thread
+    long iterations = LONG_MAX;  // total over all searches
+    double timeLimitMs = 500.0;
+    long chunkSize = 50;
+    long restartAfter = 1000;    // non-improving iterations before restarting from the shared best
+    double reaction = 0.1;
+    double startTemperature = 10.0, endTemperature = 0.5;
+
+    ParallelALNS(const ProblemData& d, std::mt19937& g, ThreadPool& p) : data(d), gen(g), pool(p) {}
+
+    Solution run(const Solution& start) {
+        int numSearches = searches > 0 ? searches : pool.size();
+        register_ = std::make_unique<BestSolutionRegister>(numSearches);
+        Solution first = start;
+        register_->publish(first, 0);
+        for (auto& w : destroyWeight) w = 1.0;
+        for (auto& w : repairWeight) w = 1.0;
+        done = 0;
+        t0 = Clock::now();
+        deadline = t0 + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(timeLimitMs));
+
+        state.clear();
+        for (int k = 0; k < numSearches; ++k) {
+            auto st = std::make_unique<Search>();
+            st->rng.seed(gen());
+            st->lns = std::make_unique<LNS>(data, st->rng);
+            st->current = first;
+            state.push_back(std::move(st));
+        }
+        for (int k = 0; k < numSearches; ++k) pool.submit([this, k] { runChunk(k); }, &tasks);
+        pool.wait(tasks);
+        elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+        Solution best;
+        uint64_t seen = 0;
+        register_->copyIfNewer(best, seen, 0);
+        return best;
+    }
+
+    long iterationCount() const { return done; }
+    double iterationsPerSecond() const { return elapsedMs > 0 ? done * 1000.0 / elapsedMs : 0.0; }
+    double publishShareRate() const { return register_ ? register_->shareRate() : 0.0; }
+
+private:
+    struct Search {
+        std::mt19937 rng;
+        std::unique_ptr<LNS> lns;
+        Solution current, candidate;
+        long sinceImprovement = 0;
+        uint64_t seenVersion = 0;
+    };
+
+    const ProblemData& data;
+    std::mt19937& gen;
+    ThreadPool& pool;
+    ThreadPool::TaskGroup tasks; // the search chunks, which resubmit themselves
+    std::unique_ptr<BestSolutionRegister> register_;
+    std::vector<std::unique_ptr<Search>> state;
+    std::atomic<double> destroyWeight[LNS::kDestroyOps], repairWeight[LNS::kRepairOps];
+    std::atomic<long> done{0};
+    Clock::time_point t0, deadline;
+    double elapsedMs = 0.0;
+
+    static int roulette(const std::atomic<double>* w, int n, std::mt19937& rng) {
+        double total = 0.0;
+        for (int k = 0; k < n; ++k) total += w[k].load(std::memory_order_relaxed);
+        double x = (rng() >> 8) * (1.0 / 16777216.0) * total;
+        for (int k = 0; k < n - 1; ++k) {
+            x -= w[k].load(std::memory_order_relaxed);
+            if (x < 0) return k;
+        }
+        return n - 1;
+    }
+
+    void reward(std::atomic<double>& w, double score) {
+        double cur = w.load(std::memory_order_relaxed);
+        while (!w.compare_exchange_weak(cur, std::max(0.01, cur * (1.0 - reaction) + reaction * score))) {}
+    }
+
+    void runChunk(int k) {
+        Search& st = *state[k];
+        for (long c = 0; c < chunkSize; ++c) {
+            Clock::time_point now = Clock::now();
+            if (now >= deadline || done >= iterations) return;
+            double progress = std::max(std::chrono::duration<double>(now - t0).count() * 1000.0 / timeLimitMs,
+                                       iterations == LONG_MAX ? 0.0 : (double)done / iterations);
+            double temp = startTemperature * std::pow(endTemperature / startTemperature, std::min(1.0, progress));
+
+            int d = roulette(destroyWeight, LNS::kDestroyOps, st.rng);
+            int r = roulette(repairWeight, LNS::kRepairOps, st.rng);
+            Solution& candidate = st.candidate;
+            candidate.assign(st.current); // copies only the routes the last iteration changed
+            bool complete = st.lns->iterate(candidate, (LNS::Destroy)d, (LNS::Repair)r);
+            ++done;
+
+            double score = 0.0;
+            double u = (st.rng() >> 8) * (1.0 / 16777216.0) + 1e-12;
+            if (!complete) score = 0.0; // the fleet had no vehicle for a route the repair needed
+            else if (register_->publish(candidate, k)) score = 33.0;
+            else if (candidate.totalCost < st.current.totalCost - 1e-9) score = 9.0;
+            else if (candidate.totalCost < st.current.totalCost - temp * std::log(u)) score = 13.0;
+            reward(destroyWeight[d], score);
+            reward(repairWeight[r], score);
+            if (score > 0) {
+                candidate.stampRoutes();
+                std::swap(st.current, candidate);
+            }
+            st.sinceImprovement = score >= 33.0 ? 0 : st.sinceImprovement + 1;
+            if (st.sinceImprovement > restartAfter) {
+                register_->copyIfNewer(st.current, st.seenVersion, k);
+                st.sinceImprovement = 0;
+            }
+        }
+        pool.submit([this, k] { runChunk(k); }, &tasks);
+    }
+};
+
+// --- Linear Split ---
+// Optimal partition of a giant tour into capacity-feasible routes with Vidal's
+// O(n) deque-based split. All buffers are sized once per instance, so decoding
+// does not allocate; route buffers of the output Solution are reused. Routes are cut
+// at one capacity, so a fleet with several capacities is rejected: it could end up
+// with more routes of some size than there are vehicles for them.
+class Split {
+public:
+    Split(const ProblemData& d) : data(d) {
+        if (!data.uniformCapacity()) throw std::runtime_error("Split needs a fleet with a single vehicle capacity");
+        size_t n = data.customers.size() + 2;
+        sumDist.resize(n); sumLoad.resize(n); fromDepot.resize(n); toDepot.resize(n);
+        potential.resize(n); pred.resize(n); queue.resize(n);
+    }
+
+    // Returns false if some customer does not fit in a vehicle on its own
+    bool run(const std::vector<int>& tour, Solution& out) {
+        int n = tour.size();
+        int capacity = data.maxCapacity();
+        sumDist[0] = sumDist[1] = 0.0;
+        sumLoad[0] = 0;
+        for (int i = 1; i <= n; ++i) {
+            int id = tour[i - 1];
+            sumLoad[i] = sumLoad[i - 1] + data.demand(id);
+            if (i > 1) sumDist[i] = sumDist[i - 1] + data.getDistance(tour[i - 2], id);
+            fromDepot[i] = data.getDistance(data.depot.id, id);
+            toDepot[i] = data.getDistance(id, data.depot.id);
+            potential[i] = std::numeric_limits<double>::infinity();
+        }
+        fromDepot[n + 1] = 0.0;
+        sumDist[n + 1] = sumDist[n];
+        potential[0] = 0.0;
+
+        // Routes serving tour positions i+1..j cost propagate(i, j)
+        auto propagate = [&](int i, int j) {
+            return potential[i] + sumDist[j] - sumDist[i + 1] + fromDepot[i + 1] + toDepot[j];
+        };
+        // j dominates i (i < j) as a predecessor of every later position. The reverse never
+        // holds under a hard capacity: j stays feasible for at least as long as i.
+        auto dominatesRight = [&](int i, int j) {
+            return potential[j] + fromDepot[j + 1] < potential[i] + fromDepot[i + 1] + sumDist[j + 1] - sumDist[i + 1] + 1e-9;
+        };
+
+        int front = 0, back = 0;
+        queue[0] = 0;
+        for (int j = 1; j <= n; ++j) {
+            if (front > back) return false;
+            potential[j] = propagate(queue[front], j);
+            pred[j] = queue[front];
+            if (j < n) {
+                while (front <= back && dominatesRight(queue[back], j)) --back;
+                queue[++back] = j;
+                while (front <= back && sumLoad[j + 1] - sumLoad[queue[front]] > capacity) ++front;
+            }
+        }
+        if (sumLoad[n] - sumLoad[pred[n]] > capacity) return false;
+
+        int numRoutes = 0;
+        for (int j = n; j > 0; j = pred[j]) ++numRoutes;
+        out.routes.resize(numRoutes);
+        int r = numRoutes;
+        for (int j = n; j > 0; j = pred[j]) {
+            Route& route = out.routes[--r];
+            route.version = 0;
+            route.customers.clear();
+            for (int k = pred[j] + 1; k <= j; ++k) route.customers.push_back(tour[k - 1]);
+            route.currentLoad = sumLoad[j] - sumLoad[pred[j]];
+        }
+        out.totalCost = potential[n];
+        for (auto& route : out.routes) route.totalDistance = routeDistance(data, route.customers);
+        assignVehicles(data, out);
+        out.computeFingerprint();
+        return true;
+    }
+
+private:
+    const ProblemData& data;
+    std::vector<double> sumDist, fromDepot, toDepot, potential;
+    std::vector<int> sumLoad, pred, queue;
+};
+
+// Concatenate the routes of a solution into a giant tour
+void giantTour(const Solution& sol, std::vector<int>& tour) {
+    tour.clear();
+    for (const auto& r : sol.routes)
+        for (NodeId c : r.customers) tour.push_back(c);
+}
+
+// --- Route-First Cluster-Second Construction ---
+// Builds one giant TSP tour over all customers (nearest neighbour, then 2-opt and
+// Or-opt on the two-level tour) and cuts it optimally into capacity-feasible
+// routes with the linear Split. O(n^2) overall, so it scales better than the
+// savings construction on large instances.
+class SplitConstructor {
+public:
+    SplitConstructor(const ProblemData& d) : data(d) {}
+    Solution solve();
+
+private:
+    const ProblemData& data;
+};
+
+Solution SplitConstructor::solve() {
+    size_t n = data.customers.size();
+    std::vector<char> visited(n, 0);
+    Route giant;
+    giant.customers.reserve(n);
+    int last = data.depot.id;
+    for (size_t k = 0; k < n; ++k) {
+        int next = -1;
+        double bestDist = std::numeric_limits<double>::infinity();
+        for (size_t c = 0; c < n; ++c) {
+            if (visited[c]) continue;
+            double dist = data.getDistance(last, data.customers[c].id);
+            if (dist < bestDist) { bestDist = dist; next = c; }
+        }
+        visited[next] = 1;
+        giant.customers.push_back(data.customers[next].id);
+        last = data.customers[next].id;
+    }
+    Solution::polishRoute(data, giant);
+
+    std::vector<int> tour;
+    Solution tmp;
+    tmp.routes.push_back(giant);
+    giantTour(tmp, tour);
+    Solution sol;
+    Split split(data);
+    if (!split.run(tour, sol)) throw std::runtime_error("A customer demand exceeds the vehicle capacity");
+    sol.calculateTotalCost(data);
+    return sol;
+}
+
+// --- Sweep Construction ---
+// Sorts customers by polar angle around the depot and cuts the angular order into
+// capacity-feasible sectors with the linear Split, for every rotation offset and
+// both directions. Offsets are spread over the pool and the cheapest one wins
+// (ties go to the lowest offset, so the result does not depend on scheduling).
+class Sweep {
+public:
+    Sweep(const ProblemData& d, ThreadPool* p = nullptr) : data(d), pool(p) {
+        // Checked here too: Split throwing inside a pool task would not reach the caller
+        if (!data.uniformCapacity()) throw std::runtime_error("Sweep needs a fleet with a single vehicle capacity");
+    }
+    Solution solve();
+
+private:
+    const ProblemData& data;
+    ThreadPool* pool;
+};
+
+Solution Sweep::solve() {
+    int n = data.customers.size();
+    // Pseudo-angle in [0, 4): monotone in atan2 and branch-free, so the loop over the
+    // coordinate arrays vectorizes
+    std::vector<double> key(n);
+    const double* xs = data.coordX.data();
+    const double* ys = data.coordY.data();
+    double cx = data.depot.x, cy = data.depot.y;
+    for (int i = 0; i < n; ++i) {
+        double dx = xs[i] - cx, dy = ys[i] - cy;
+        double p = dy / (std::fabs(dx) + std::fabs(dy) + 1e-300);
+        double left = dx < 0 ? 1.0 : 0.0, below = dy < 0 ? 1.0 : 0.0;
+        key[i] = p + left * (2.0 - 2.0 * p) + (1.0 - left) * below * 4.0; // 2 - p left, 4 + p below right
+    }
+    std::vector<int> order(n);
+    for (int i = 0; i < n; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return key[a] < key[b]; });
+    for (auto& i : order) i = data.customers[i].id;
+
+    // Candidate c is rotation offset c / 2, clockwise when c is odd
+    int numCandidates = 2 * n;
+    int numChunks = pool ? std::min<int>(numCandidates, 4 * pool->size()) : 1;
+    std::vector<std::pair<double, int>> chunkBest(numChunks, {std::numeric_limits<double>::infinity(), -1});
+    auto rotated = [&](int c, std::vector<int>& tour) {
+        int offset = c / 2;
+        for (int k = 0; k < n; ++k)
+            tour[k] = c % 2 ? order[(offset - k + n) % n] : order[(offset + k) % n];
+    };
+    auto runChunk = [&](int chunk) {
+        Split split(data);
+        Solution sol;
+        std::vector<int> tour(n);
+        for (int c = chunk; c < numCandidates; c += numChunks) {
+            rotated(c, tour);
+            if (split.run(tour, sol) && sol.totalCost < chunkBest[chunk].first) chunkBest[chunk] = {sol.totalCost, c};
+        }
+    };
+    ThreadPool::TaskGroup group;
+    for (int chunk = 0; chunk < numChunks; ++chunk) {
+        if (pool) pool->submit([&, chunk] { runChunk(chunk); }, &group);
+        else runChunk(chunk);
+    }
+    if (pool) pool->wait(group);
+    auto best = *std::min_element(chunkBest.begin(), chunkBest.end());
+    if (best.second < 0) throw std::runtime_error("A customer demand exceeds the vehicle capacity");
+
+    std::vector<int> tour(n);
+    rotated(best.second, tour);
+    Solution sol;
+    Split(data).run(tour, sol);
+    sol.optimizeRoutes(data, nullptr, pool);
     return sol;
 }
 
+// --- Hybrid Genetic Search ---
+// Population of giant-tour chromosomes decoded with the linear Split. Children
+// come from OX crossover of binary-tournament parents and are educated by the
+// local search. Survivors are chosen by biased fitness: cost rank plus diversity
+// rank, diversity being the mean broken-pairs distance to the closest individuals.
+// Clarke-Wright seeds the population. Individuals are recycled through a free list.
+class HybridGeneticSearch {
+public:
+    int populationSize = 25, generationSize = 40, eliteCount = 4, closeCount = 5;
+    long maxIterationsNoImprovement = 20000;
+    double timeLimitMs = 1000.0;
+
+    HybridGeneticSearch(const ProblemData& d, std::mt19937& g) : data(d), gen(g), split(d), ls(d) {}
+
+    Solution run(const Solution& seed) {
+        Clock::time_point t0 = Clock::now();
+        deadline = t0 + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(timeLimitMs));
+        int n = data.customers.size();
+        childTour.resize(n);
+        used.resize(n + 1);
+        work.routes.clear();
+        best = seed;
+        iterations = 0;
+
+        giantTour(seed, childTour);
+        educateAndInsert();
+        std::vector<int> perm(n);
+        for (int k = 0; k < n; ++k) perm[k] = data.customers[k].id;
+        for (int k = 0; k < 4 * populationSize && Clock::now() < deadline; ++k) {
+            std::shuffle(perm.begin(), perm.end(), gen);
+            childTour = perm;
+            educateAndInsert();
+        }
+
+        long sinceImprovement = 0;
+        while (sinceImprovement < maxIterationsNoImprovement && Clock::now() < deadline) {
+            ++iterations;
+            double before = best.totalCost;
+            crossoverOX(tournament()->tour, tournament()->tour);
+            educateAndInsert();
+            sinceImprovement = best.totalCost < before - 1e-9 ? 0 : sinceImprovement + 1;
+        }
+        return best;
+    }
+
+    long iterationCount() const { return iterations; }
+
+private:
+    struct Individual {
+        std::vector<int> tour, succ, pred;
+        double cost = 0.0, fitness = 0.0;
+        uint64_t fingerprint = 0;
+        std::vector<std::pair<double, Individual*>> proximity; // sorted broken-pairs distances
+    };
+
+    const ProblemData& data;
+    std::mt19937& gen;
+    Split split;
+    LocalSearch ls;
+    Clock::time_point deadline;
+    Solution work, best;
+    std::vector<int> childTour;
+    std::vector<char> used;
+    std::vector<Individual*> population, freeList;
+    std::vector<std::unique_ptr<Individual>> storage;
+    long iterations = 0;
+
+    // Decode childTour, educate it, and add the result to the population
+    void educateAndInsert() {
+        if (!split.run(childTour, work)) return;
+        ls.run(work, deadline);
+        if (work.totalCost < best.totalCost - 1e-9) best = work;
+        for (const Individual* ind : population)
+            if (ind->fingerprint == work.fingerprint) return; // clone of a member: skip the O(n) distances
+
+        Individual* ind;
+        if (freeList.empty()) { storage.push_back(std::make_unique<Individual>()); ind = storage.back().get(); }
+        else { ind = freeList.back(); freeList.pop_back(); }
+        giantTour(work, ind->tour);
+        ind->cost = work.totalCost;
+        ind->fingerprint = work.fingerprint;
+        work.neighbours(data, ind->succ, ind->pred);
+        ind->proximity.clear();
+        for (Individual* other : population) {
+            double dist = Solution::brokenPairs(ind->succ, ind->pred, other->succ, other->pred);
+            auto entry = std::make_pair(dist, other);
+            ind->proximity.insert(std::upper_bound(ind->proximity.begin(), ind->proximity.end(), entry), entry);
+            entry.second = ind;
+            other->proximity.insert(std::upper_bound(other->proximity.begin(), other->proximity.end(), entry), entry);
+        }
+        population.push_back(ind);
+        if ((int)population.size() > populationSize + generationSize)
+            while ((int)population.size() > populationSize) removeWorst();
+    }
+
+    double diversity(const Individual& ind) const {
+        int count = std::min<int>(closeCount, ind.proximity.size());
+        double sum = 0.0;
+        for (int k = 0; k < count; ++k) sum += ind.proximity[k].first;
+        return count ? sum / count : 0.0;
+    }
+
+    // Biased fitness: cost rank plus weighted diversity rank, both normalized
+    void updateFitness() {
+        int size = population.size();
+        if (size <= 1) { for (auto* ind : population) ind->fitness = 0.0; return; }
+        std::vector<std::pair<double, int>> rank(size);
+        for (int k = 0; k < size; ++k) rank[k] = {-diversity(*population[k]), k};
+        std::sort(rank.begin(), rank.end());
+        std::vector<double> divRank(size);
+        for (int k = 0; k < size; ++k) divRank[rank[k].second] = (double)k / (size - 1);
+        for (int k = 0; k < size; ++k) rank[k] = {population[k]->cost, k};
+        std::sort(rank.begin(), rank.end());
+        double divWeight = 1.0 - (double)eliteCount / size;
+        for (int k = 0; k < size; ++k)
+            population[rank[k].second]->fitness = (double)k / (size - 1) + divWeight * divRank[rank[k].second];
+    }
+
+    // Remove the worst biased fitness, clones first
+    void removeWorst() {
+        updateFitness();
+        int worst = -1;
+        bool worstIsClone = false;
+        for (size_t k = 0; k < population.size(); ++k) {
+            Individual* ind = population[k];
+            bool clone = !ind->proximity.empty() && ind->proximity.front().first < 1e-9;
+            if (worst < 0 || (clone && !worstIsClone) ||
+                (clone == worstIsClone && ind->fitness > population[worst]->fitness)) {
+                worst = k; worstIsClone = clone;
+            }
+        }
+        Individual* gone = population[worst];
+        population.erase(population.begin() + worst);
+        for (Individual* other : population) {
+            auto& prox = other->proximity;
+            prox.erase(std::remove_if(prox.begin(), prox.end(),
+                                      [gone](const std::pair<double, Individual*>& e) { return e.second == gone; }),
+                       prox.end());
+        }
+        freeList.push_back(gone);
+    }
+
+    Individual* tournament() {
+        updateFitness();
+        Individual* a = population[gen() % population.size()];
+        Individual* b = population[gen() % population.size()];
+        return a->fitness < b->fitness ? a : b;
+    }
+
+    // Order crossover: copy a random slice of p1, fill the rest in p2 order
+    void crossoverOX(const std::vector<int>& p1, const std::vector<int>& p2) {
+        int n = p1.size();
+        int start = gen() % n, end = gen() % n;
+        std::fill(used.begin(), used.end(), 0);
+        // Copy the len positions start..end (wrapping, the whole tour when end == start - 1),
+        // then fill the other n - len positions in p2's order after end
+        int len = (end - start + n) % n + 1;
+        for (int c = 0; c < len; ++c) {
+            int k = (start + c) % n;
+            childTour[k] = p1[k];
+            used[p1[k]] = 1;
+        }
+        int k = (start + len) % n;
+        for (int j = 0, filled = len; j < n && filled < n; ++j) {
+            int id = p2[(end + 1 + j) % n];
+            if (used[id]) continue;
+            childTour[k] = id;
+            k = (k + 1) % n;
+            ++filled;
+        }
+    }
+};
+
+// --- Granular Tabu Search ---
+// Open-addressing hash of (customer, route) attributes to the iteration until which
+// moving that customer back into that route is tabu. Sized for every possible key,
+// so inserts and lookups are O(1) and never fail.
+class TabuAttributeStore {
+public:
+    void reset(size_t maxKeys) {
+        size_t cap = 16;
+        while (cap < 2 * maxKeys) cap <<= 1;
+        keys.assign(cap, kEmpty);
+        expiry.assign(cap, 0);
+    }
+
+    void set(int customer, int route, long until) {
+        size_t k = find(key(customer, route));
+        keys[k] = key(customer, route);
+        expiry[k] = until;
+    }
+
+    bool isTabu(int customer, int route, long iteration) const {
+        size_t k = find(key(customer, route));
+        return keys[k] != kEmpty && expiry[k] > iteration;
+    }
+
+private:
+    static constexpr uint64_t kEmpty = UINT64_MAX;
+    std::vector<uint64_t> keys;
+    std::vector<long> expiry;
+
+    static uint64_t key(int customer, int route) { return ((uint64_t)(uint32_t)customer << 32) | (uint32_t)route; }
+
+    size_t find(uint64_t k) const {
+        size_t mask = keys.size() - 1;
+        size_t h = RouteCostCache::mix(k) & mask;
+        while (keys[h] != kEmpty && keys[h] != k) h = (h + 1) & mask;
+        return h;
+    }
+};
+
+// Toth-Vigo style granular tabu search: each iteration evaluates relocate (before or
+// after a neighbour) and inter-route swap moves between every customer and its k
+// nearest neighbours only, O(n*k) moves, and applies the best one that is not tabu
+// or beats the best known cost (aspiration). A customer moved out of a route may
+// not return to it (nor move again inside it) for a random tenure.
+class TabuSearch {
+public:
+    int neighbours = 10;
+    int minTenure = 10, maxTenure = 25;
+    long iterations = 20000;
+    double timeLimitMs = 1000.0;
+
+    TabuSearch(const ProblemData& d, std::mt19937& g) : data(d), gen(g) {
+        int n = data.customers.size();
+        int k = std::min(neighbours, n - 1);
+        near.resize((size_t)n * k);
+        std::vector<int> cand(n);
+        for (int u = 0; u < n; ++u) {
+            for (int v = 0; v < n; ++v) cand[v] = v;
+            std::swap(cand[u], cand[n - 1]);
+            int uid = data.customers[u].id;
+            std::partial_sort(cand.begin(), cand.begin() + k, cand.end() - 1, [&](int a, int b) {
+                return data.getDistance(uid, data.customers[a].id) < data.getDistance(uid, data.customers[b].id);
+            });
+            for (int t = 0; t < k; ++t) near[(size_t)u * k + t] = data.customers[cand[t]].id;
+        }
+        numNeighbours = k;
+    }
+
+    Solution run(const Solution& start) {
+        Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                                        std::chrono::duration<double, std::milli>(timeLimitMs));
+        Solution sol = start, best = start;
+        sol.calculateTotalCost(data);
+        int n = data.customers.size();
+        tabu.reset((size_t)n * sol.routes.size());
+        where.assign(n + 1, {-1, -1});
+        for (size_t r = 0; r < sol.routes.size(); ++r) locate(sol, r);
+
+        for (done = 0; done < iterations && Clock::now() < deadline; ++done) {
+            Move m = bestMove(sol, best.totalCost);
+            if (m.type < 0) break;
+            apply(sol, m);
+            if (sol.totalCost < best.totalCost - 1e-9) best = sol;
+        }
+        best.routes.erase(std::remove_if(best.routes.begin(), best.routes.end(),
+                                         [](const Route& r) { return r.customers.empty(); }), best.routes.end());
+        best.calculateTotalCost(data);
+        return best;
+    }
+
+    long iterationCount() const { return done; }
+
+private:
+    struct Move { int type; int u, v; int pos; bool before; double delta; }; // type 0 relocate, 1 swap
+
+    const ProblemData& data;
+    std::mt19937& gen;
+    std::vector<int> near;
+    int numNeighbours = 0;
+    TabuAttributeStore tabu;
+    std::vector<std::pair<int, int>> where; // (route, position) by customer id
+    long done = 0;
+
+    int at(const Route& r, int k) const {
+        return (k < 0 || k >= (int)r.customers.size()) ? data.depot.id : r.customers[k];
+    }
+    double d(int a, int b) const { return data.getDistance(a, b); }
+
+    void locate(const Solution& sol, int r) {
+        for (size_t k = 0; k < sol.routes[r].customers.size(); ++k) where[sol.routes[r].customers[k]] = {r, (int)k};
+    }
+
+    Move bestMove(const Solution& sol, double bestCost) {
+        Move best{-1, 0, 0, 0, false, std::numeric_limits<double>::infinity()};
+        for (const auto& cu : data.customers) {
+            int u = cu.id;
+            auto [a, i] = where[u];
+            const Route& A = sol.routes[a];
+            double removeGain = d(at(A, i - 1), u) + d(u, at(A, i + 1)) - d(at(A, i - 1), at(A, i + 1));
+            for (int t = 0; t < numNeighbours; ++t) {
+                int v = near[(size_t)(u - 1) * numNeighbours + t];
+                auto [b, j] = where[v];
+                const Route& B = sol.routes[b];
+                bool fits = a == b || B.currentLoad + data.demand(u) <= data.vehicles[B.vehicleId].capacity;
+                // Relocate u right before (k = j) or right after (k = j + 1) v
+                for (int k = j; fits && k <= j + 1; ++k) {
+                    if (a == b && (k == i || k == i + 1)) continue;
+                    double delta = d(at(B, k - 1), u) + d(u, at(B, k)) - d(at(B, k - 1), at(B, k)) - removeGain;
+                    if (delta < best.delta && allowed(u, b, -1, -1, sol.totalCost + delta, bestCost))
+                        best = {0, u, v, k, k == j, delta};
+                }
+                // Swap u and v
+                if (a == b) continue;
+                int shift = data.demand(v) - data.demand(u);
+                if (A.currentLoad + shift > data.vehicles[A.vehicleId].capacity ||
+                    B.currentLoad - shift > data.vehicles[B.vehicleId].capacity) continue;
+                int pa = at(A, i - 1), na = at(A, i + 1), pb = at(B, j - 1), nb = at(B, j + 1);
+                double delta = d(pa, v) + d(v, na) - d(pa, u) - d(u, na) + d(pb, u) + d(u, nb) - d(pb, v) - d(v, nb);
+                if (delta < best.delta && allowed(u, b, v, a, sol.totalCost + delta, bestCost))
+                    best = {1, u, v, j, false, delta};
+            }
+        }
+        return best;
+    }
+
+    bool allowed(int u, int b, int v, int a, double cost, double bestCost) const {
+        if (cost < bestCost - 1e-9) return true; // aspiration
+        return !tabu.isTabu(u, b, done) && (v < 0 || !tabu.isTabu(v, a, done));
+    }
+
+    long tenure() { return done + minTenure + gen() % (maxTenure - minTenure + 1); }
+
+    void apply(Solution& sol, const Move& m) {
+        auto [a, i] = where[m.u];
+        auto [b, j] = where[m.v];
+        Route &A = sol.routes[a], &B = sol.routes[b];
+        double before = A.totalDistance + (a != b ? B.totalDistance : 0.0);
+        if (m.type == 0) {
+            NodeId c = A.customers[i];
+            A.customers.erase(A.customers.begin() + i);
+            B.customers.insert(B.customers.begin() + (a == b && m.pos > i ? m.pos - 1 : m.pos), c);
+            A.currentLoad -= data.demand(m.u);
+            B.currentLoad += data.demand(m.u);
+            tabu.set(m.u, a, tenure());
+        } else {
+            int shift = data.demand(m.v) - data.demand(m.u);
+            std::swap(A.customers[i], B.customers[j]);
+            A.currentLoad += shift;
+            B.currentLoad -= shift;
+            tabu.set(m.u, a, tenure());
+            tabu.set(m.v, b, tenure());
+        }
+        A.totalDistance = routeDistance(data, A.customers);
+        B.totalDistance = routeDistance(data, B.customers);
+        A.version = B.version = 0;
+        sol.totalCost += A.totalDistance + (a != b ? B.totalDistance : 0.0) - before;
+        locate(sol, a);
+        if (a != b) locate(sol, b);
+    }
+};
+
+// --- Compact Binary Solution Format ---
+// "VRPS", u8 version, u8 id width (2 or 4 bytes), u16 unused, f64 total cost, u32 route
+// count, then per route i32 vehicle id, u32 length and the customer ids. Host byte
+// order: every island runs on the same architecture.
+void encodeSolution(const Solution& sol, std::vector<uint8_t>& out) {
+    size_t maxId = 0;
+    for (const auto& r : sol.routes)
+        for (NodeId c : r.customers) maxId = std::max<size_t>(maxId, c);
+    uint8_t width = maxId < 65536 ? 2 : 4;
+    out.clear();
+    auto put = [&](const void* p, size_t n) { out.insert(out.end(), (const uint8_t*)p, (const uint8_t*)p + n); };
+    uint8_t header[8] = {'V', 'R', 'P', 'S', 1, width, 0, 0};
+    put(header, 8);
+    put(&sol.totalCost, sizeof(double));
+    uint32_t numRoutes = sol.routes.size();
+    put(&numRoutes, 4);
+    for (const auto& r : sol.routes) {
+        int32_t vehicle = r.vehicleId;
+        uint32_t len = r.customers.size();
+        put(&vehicle, 4);
+        put(&len, 4);
+        for (NodeId c : r.customers) {
+            uint32_t id = c;
+            uint16_t small = id;
+            if (width == 2) put(&small, 2); else put(&id, 4);
+        }
+    }
+}
+
+// Returns false on a malformed buffer or unknown customer ids
+bool decodeSolution(const ProblemData& data, const uint8_t* bytes, size_t size, Solution& out) {
+    size_t pos = 0;
+    auto get = [&](void* p, size_t n) {
+        if (pos + n > size) return false;
+        std::memcpy(p, bytes + pos, n);
+        pos += n;
+        return true;
+    };
+    uint8_t header[8];
+    uint32_t numRoutes;
+    if (!get(header, 8) || std::memcmp(header, "VRPS", 4) != 0 || header[4] != 1) return false;
+    uint8_t width = header[5];
+    if ((width != 2 && width != 4) || !get(&out.totalCost, sizeof(double)) || !get(&numRoutes, 4)) return false;
+    out.routes.clear();
+    for (uint32_t r = 0; r < numRoutes; ++r) {
+        int32_t vehicle;
+        uint32_t len;
+        if (!get(&vehicle, 4) || !get(&len, 4) || len > data.customers.size()) return false;
+        Route route(vehicle);
+        for (uint32_t k = 0; k < len; ++k) {
+            uint32_t id = 0;
+            uint16_t small;
+            if (width == 2) { if (!get(&small, 2)) return false; id = small; }
+            else if (!get(&id, 4)) return false;
+            if (id == 0 || id > data.customers.size()) return false;
+            route.customers.push_back(id);
+            route.currentLoad += data.demand(id);
+        }
+        out.routes.push_back(route);
+    }
+    return pos == size;
+}
+
+#ifdef VRP_HAS_SOCKETS
+// --- Island Model ---
+// One solver process per island, each running LNS epochs on its own. After every
+// epoch the island posts its best solution to an outbox and adopts a migrant from its
+// inbox if that is better than its current solution. A separate migration thread owns
+// the sockets: it sends the outbox to the next island of the ring and reads migrants
+// from the previous one. The search thread only try_locks the boxes, so it never
+// waits on the network; a new best that misses the lock is posted after the next epoch.
+// Sends time out after sendTimeoutMs, so a peer that stops reading cannot block shutdown.
+// Islands talk over TCP on 127.0.0.1 (port basePort + index) or Unix domain sockets,
+// with length-prefixed frames in the binary solution format.
+class IslandModel {
+public:
+    int basePort = 47000;
+    bool unixSockets = false;
+    double epochMs = 200.0;
+    double timeLimitMs = 3000.0;
+    int sendTimeoutMs = 100;
+
+    IslandModel(const ProblemData& d, std::mt19937& g, int idx, int cnt) : data(d), gen(g), index(idx), count(cnt) {
+        if (count < 1 || index < 0 || index >= count)
+            throw std::runtime_error("Island index " + std::to_string(index) + " is not in [0, " + std::to_string(count) + ")");
+    }
+
+    Solution run(const Solution& start) {
+        Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                                        std::chrono::duration<double, std::milli>(timeLimitMs));
+        stopping = false;
+        std::thread migration([this] { migrationLoop(); });
+        Solution current = start, best = start, migrant;
+        LNS lns(data, gen);
+        std::vector<uint8_t> buffer, pending;
+        bool posting = false;
+        while (Clock::now() < deadline) {
+            double left = std::chrono::duration<double, std::milli>(deadline - Clock::now()).count();
+            lns.timeLimitMs = std::max(1.0, std::min(epochMs, left));
+            lns.iterations = LONG_MAX;
+            current = lns.run(current);
+            if (current.totalCost < best.totalCost - 1e-9) {
+                best = current;
+                encodeSolution(best, pending);
+                posting = true;
+            }
+            std::unique_lock<std::mutex> lock(boxMutex, std::try_to_lock);
+            if (!lock.owns_lock()) continue;
+            if (posting) { outbox.swap(pending); outboxReady = true; posting = false; }
+            if (inboxReady) {
+                buffer.swap(inbox);
+                inboxReady = false;
+                lock.unlock();
+                if (decodeSolution(data, buffer.data(), buffer.size(), migrant) && migrant.isValid(data)) {
+                    migrant.calculateTotalCost(data);
+                    if (migrant.totalCost < current.totalCost - 1e-9) {
+                        current = migrant;
+                        ++accepted;
+                        if (current.totalCost < best.totalCost - 1e-9) best = current;
+                    }
+                }
+            }
+        }
+        stopping = true;
+        migration.join();
+        return best;
+    }
+
+    long migrantsSent() const { return sent; }
+    long migrantsReceived() const { return received; }
+    long migrantsAccepted() const { return accepted; }
+
+private:
+    const ProblemData& data;
+    std::mt19937& gen;
+    int index, count;
+    std::mutex boxMutex;
+    std::vector<uint8_t> outbox, inbox;
+    bool outboxReady = false, inboxReady = false;
+    std::atomic<bool> stopping{false};
+    std::atomic<long> sent{0}, received{0};
+    long accepted = 0;
+
+    std::string socketPath(int island) const { return "/tmp/vrp-island-" + std::to_string(basePort + island) + ".sock"; }
+
+    int openListener() {
+        int fd;
+        if (unixSockets) {
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::string path = socketPath(index);
+            unlink(path.c_str());
+            std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+            if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { if (fd >= 0) close(fd); return -1; }
+        } else {
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(basePort + index);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { if (fd >= 0) close(fd); return -1; }
+        }
+        listen(fd, 8);
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        return fd;
+    }
+
+    int connectToNext() {
+        int next = (index + 1) % count;
+        int fd;
+        if (unixSockets) {
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, socketPath(next).c_str(), sizeof(addr.sun_path) - 1);
+            if (fd >= 0 && connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) return fd;
+        } else {
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(basePort + next);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (fd >= 0 && connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                return fd;
+            }
+        }
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    // Fails when the peer has not taken the bytes within the socket's send timeout
+    static bool sendAll(int fd, const uint8_t* p, size_t n) {
+        while (n > 0) {
+            ssize_t k = send(fd, p, n, MSG_NOSIGNAL);
+            if (k <= 0) return false;
+            p += k; n -= k;
+        }
+        return true;
+    }
+
+    void migrationLoop() {
+        int listener = openListener();
+        if (listener < 0) std::cerr << "Island " << index << ": could not listen for migrants" << std::endl;
+        int peer = -1;
+        std::vector<int> conns;
+        std::vector<std::vector<uint8_t>> pendingBytes;
+        std::vector<uint8_t> frame;
+        uint8_t chunk[4096];
+        while (!stopping) {
+            std::vector<pollfd> fds;
+            if (listener >= 0) fds.push_back({listener, POLLIN, 0});
+            for (int c : conns) fds.push_back({c, POLLIN, 0});
+            poll(fds.data(), fds.size(), 20);
+
+            if (listener >= 0 && (fds[0].revents & POLLIN)) {
+                int c = accept(listener, nullptr, nullptr);
+                if (c >= 0) { fcntl(c, F_SETFL, O_NONBLOCK); conns.push_back(c); pendingBytes.emplace_back(); }
+            }
+            for (size_t k = 0; k < conns.size(); ++k) {
+                ssize_t got;
+                while ((got = recv(conns[k], chunk, sizeof(chunk), 0)) > 0)
+                    pendingBytes[k].insert(pendingBytes[k].end(), chunk, chunk + got);
+                // Keep only the newest complete frame
+                auto& buf = pendingBytes[k];
+                size_t pos = 0;
+                uint32_t len;
+                while (buf.size() - pos >= 4 && (std::memcpy(&len, buf.data() + pos, 4), buf.size() - pos - 4 >= len)) {
+                    frame.assign(buf.begin() + pos + 4, buf.begin() + pos + 4 + len);
+                    pos += 4 + len;
+                    ++received;
+                    std::lock_guard<std::mutex> lock(boxMutex);
+                    inbox.swap(frame);
+                    inboxReady = true;
+                }
+                buf.erase(buf.begin(), buf.begin() + pos);
+                if (got == 0) { close(conns[k]); conns.erase(conns.begin() + k); pendingBytes.erase(pendingBytes.begin() + k); --k; }
+            }
+
+            if (count > 1) {
+                {
+                    std::lock_guard<std::mutex> lock(boxMutex);
+                    if (outboxReady) { frame.swap(outbox); outboxReady = false; }
+                    else frame.clear();
+                }
+                if (!frame.empty()) {
+                    if (peer < 0 && (peer = connectToNext()) >= 0) {
+                        timeval timeout{sendTimeoutMs / 1000, (sendTimeoutMs % 1000) * 1000};
+                        setsockopt(peer, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                    }
+                    uint32_t len = frame.size();
+                    if (peer >= 0 && sendAll(peer, (const uint8_t*)&len, 4) && sendAll(peer, frame.data(), len)) ++sent;
+                    else if (peer >= 0) { close(peer); peer = -1; }
+                }
+            }
+        }
+        for (int c : conns) close(c);
+        if (peer >= 0) close(peer);
+        if (listener >= 0) close(listener);
+        if (unixSockets) unlink(socketPath(index).c_str());
+    }
+};
+#endif
+
+// --- Constructor Portfolio ---
+// Runs several constructors concurrently on the pool and returns the cheapest valid
+// solution among those finished by the deadline. Late results are dropped (the
+// shared state outlives the call). Wins are counted per constructor across runs.
+class ConstructorPortfolio {
+public:
+    double timeLimitMs = 1000.0;
+
+    ConstructorPortfolio(const ProblemData& d, ThreadPool& p) : data(d), pool(p) {}
+
+    void add(const std::string& name, std::function<Solution()> build) {
+        entries.push_back({name, std::move(build)});
+        wins.push_back({name, 0});
+    }
+
+    // Clarke-Wright (plain and shaped), sweep, Split and regret insertion
+    void addDefaults(std::mt19937& gen) {
+        const ProblemData& d = data;
+        add("Clarke-Wright", [&d] { return ClarkeWright(d).solve(); });
+        add("Clarke-Wright (shape 0.6)", [&d] { return ClarkeWright(d, 0.6).solve(); });
+        add("Clarke-Wright (shape 1.4)", [&d] { return ClarkeWright(d, 1.4).solve(); });
+        if (d.uniformCapacity()) {
+            add("Sweep", [&d] { return Sweep(d).solve(); }); // no nested pool: tasks must not wait on it
+            add("Split", [&d] { return SplitConstructor(d).solve(); });
+        }
+        unsigned seed = gen();
+        add("Regret insertion", [&d, seed] {
+            std::mt19937 rng(seed);
+            LNS lns(d, rng);
+            lns.regretK = 3;
+            lns.blinkRate = 0.0;
+            return lns.construct(LNS::Repair::Regret);
+        });
+    }
+
+    Solution run() {
+        auto shared = std::make_shared<Shared>();
+        shared->results.resize(entries.size());
+        shared->remaining = entries.size();
+        Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                                        std::chrono::duration<double, std::milli>(timeLimitMs));
+        for (size_t k = 0; k < entries.size(); ++k) {
+            auto build = entries[k].second;
+            const ProblemData* d = &data;
+            pool.submit([shared, build, d, k, deadline] {
+                std::unique_ptr<Solution> sol;
+                if (Clock::now() < deadline) {
+                    try {
+                        sol = std::make_unique<Solution>(build());
+                        if (!sol->isValid(*d)) sol.reset();
+                    } catch (const std::exception&) { sol.reset(); }
+                }
+                std::lock_guard<std::mutex> lock(shared->m);
+                shared->results[k] = std::move(sol);
+                --shared->remaining;
+                shared->cv.notify_all();
+            });
+        }
+
+        std::unique_lock<std::mutex> lock(shared->m);
+        shared->cv.wait_until(lock, deadline, [&] { return shared->remaining == 0; });
+        int best = -1;
+        for (size_t k = 0; k < entries.size(); ++k) {
+            const auto& r = shared->results[k];
+            if (r && (best < 0 || r->totalCost < shared->results[best]->totalCost)) best = k;
+        }
+        if (best < 0) throw std::runtime_error("No constructor finished with a valid solution before the deadline");
+        ++wins[best].second;
+        lastWinner = entries[best].first;
+        return *shared->results[best];
+    }
+
+    const std::vector<std::pair<std::string, int>>& winCounts() const { return wins; }
+    const std::string& winner() const { return lastWinner; }
+
+private:
+    struct Shared {
+        std::mutex m;
+        std::condition_variable cv;
+        std::vector<std::unique_ptr<Solution>> results;
+        size_t remaining = 0;
+    };
+
+    const ProblemData& data;
+    ThreadPool& pool;
+    std::vector<std::pair<std::string, std::function<Solution()>>> entries;
+    std::vector<std::pair<std::string, int>> wins;
+    std::string lastWinner;
+};
+
+// Time each constructor over a few repetitions and report its average cost and speed
+void benchmarkConstructors(const ProblemData& data, int repetitions = 10) {
+    auto bench = [&](const std::string& name, const std::function<Solution()>& build) {
+        Clock::time_point t0 = Clock::now();
+        Solution sol;
+        try {
+            for (int k = 0; k < repetitions; ++k) sol = build();
+        } catch (const std::exception& e) {
+            std::cout << name << ": skipped (" << e.what() << ")\n";
+            return;
+        }
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count() / repetitions;
+        std::cout << name << ": cost " << sol.totalCost << ", routes " << sol.routes.size() << ", "
+                  << ms << " ms" << (sol.isValid(data) ? "" : " (invalid)") << "\n";
+    };
+    bench("Clarke-Wright", [&] { return ClarkeWright(data).solve(); });
+    bench("Split", [&] { return SplitConstructor(data).solve(); });
+    ThreadPool pool;
+    bench("Sweep", [&] { return Sweep(data, &pool).solve(); });
+    std::mt19937 gen(42);
+    bench("Regret insertion", [&] { LNS lns(data, gen); lns.blinkRate = 0.0; return lns.construct(LNS::Repair::Regret); });
+}
+
 std::mt19937 initRandomEngine(bool fixed = false, unsigned int seed = 42) {
     if (fixed) return std::mt19937(seed);
     return std::mt19937(std::chrono::high_resolution_clock::now().time_since_epoch().count());
@@ -255,36 +3880,244 @@ void exportSolutionToCSV(const Solution& sol, const ProblemData& data, const std
         if (r.vehicleId < 0) continue;
         f << "# Vehicle Route " << r.vehicleId << "\n";
         f << data.depot.x << "," << data.depot.y << "," << data.depot.id << "\n";
-        for (const auto& c : r.customers) f << c.x << "," << c.y << "," << c.id << "\n";
+        for (NodeId id : r.customers) {
+            const Customer& c = data.node(id);
+            f << c.x << "," << c.y << "," << c.id << "\n";
+        }
         f << data.depot.x << "," << data.depot.y << "," << data.depot.id << "\n";
     }
     f.close();
     std::cout << "CSV generated: " << file << std::endl;
 }
 
-int main() {
+// --- Route Version Checks ---
+// The "versions" method replays copies that recycle route buffers through the spare pool
+// and checks that no route is skipped because a recycled buffer kept its old version.
+bool checkRouteRecycling(const ProblemData& data, const Solution& start) {
+    Solution k = start, fewer, c;
+    k.stampRoutes();
+    fewer.assign(k);
+    fewer.routes.pop_back();
+    c.assign(k);
+    c.assign(fewer); // k's last route goes to the spare pool with its version
+    c.assign(k);     // and its cleared buffer comes back at the index of that version
+    size_t empty = 0;
+    for (const auto& r : c.routes) empty += r.customers.empty();
+    bool ok = empty == 0 && c.isValid(data);
+    std::cout << "Route recycling: " << c.routes.size() << " routes, " << empty << " empty, "
+              << (ok ? "valid" : "invalid") << "\n";
+    return ok;
+}
+
+#ifdef VRP_COUNT_ALLOCATIONS
+// --- Allocation Counting ---
+// Built with -DVRP_COUNT_ALLOCATIONS, global new is counted and the "allocs" method checks
+// that anytime search steps perform no heap allocations once their buffers are warm.
+std::atomic<size_t> heapAllocations{0};
+
+void* operator new(size_t size) {
+    ++heapAllocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete" // new above is malloc-based too
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+bool checkSteadyStateAllocations(const ProblemData& data, const Solution& start, std::mt19937& gen,
+                                 int warmup = 500, int steps = 2000) {
+    AnytimeSolver anytime(data, gen);
+    anytime.timeLimitMs = 1e9;
+    Clock::time_point deadline = anytime.begin(start);
+    for (int k = 0; k < warmup; ++k) anytime.step(deadline);
+    size_t before = heapAllocations.load();
+    for (int k = 0; k < steps; ++k) anytime.step(deadline);
+    size_t count = heapAllocations.load() - before;
+    std::cout << "Heap allocations in " << steps << " steady-state steps: " << count << "\n";
+    return count == 0;
+}
+#endif
+
+int main(int argc, char** argv) {
     ProblemData data;
-    try { data.loadData("data/Coord.txt", "data/Dist.txt", 20, 12); }
+    try {
+        data.loadData("data/Coord.txt", "data/Dist.txt", 20, 12);
+        if (std::ifstream("data/Fleet.txt").good()) data.loadFleet("data/Fleet.txt");
+        if (std::ifstream("data/Demand.txt").good()) data.loadDemands("data/Demand.txt");
+        data.checkDemands();
+    }
     catch (const std::exception& e) { std::cerr << e.what() << std::endl; return 1; }
 
+    // Usage: VRP-Clarke-Wright [method] [constructor] [--fleet-limit], constructor is "cw" (default),
+    // "split", "sweep" or "portfolio". Island runs: VRP-Clarke-Wright island <index> <count> [basePort]
+    // Simulated annealing takes a replica count, sa [constructor] [replicas], and runs parallel
+    // tempering when it is above 1. --fleet-limit removes routes beyond the fleet size so every
+    // route gets its own vehicle. Split, sweep and hgs need a single vehicle capacity.
+    // "versions" checks that copies recycling route buffers keep every customer
+    std::vector<std::string> args;
+    bool fleetLimit = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--fleet-limit") fleetLimit = true;
+        else args.push_back(argv[i]);
+    }
+    std::string method = args.size() > 0 ? args[0] : "anytime";
+    int replicas = 1;
+    if (method == "sa" && args.size() > 1 && args.back().find_first_not_of("0123456789") == std::string::npos) {
+        replicas = std::max(1, std::atoi(args.back().c_str()));
+        args.pop_back();
+    }
+    std::string constructor = args.size() > 1 && method != "island" ? args[1] : "cw";
+    std::string csvFile = "routes_solution.csv";
+    if (method == "bench") { benchmarkConstructors(data); return 0; }
+    if (!data.uniformCapacity() && (constructor == "split" || constructor == "sweep" || method == "hgs")) {
+        std::cerr << "Split, sweep and hgs need a fleet with a single vehicle capacity" << std::endl;
+        return 1;
+    }
+
     std::mt19937 gen = initRandomEngine(false);
-    ClarkeWright cw(data);
-    Solution s = cw.solve();
-    s.optimizeRoutes2Opt(data);
-    s.calculateTotalCost(data);
+    RouteCostCache routeCache;
+    ThreadPool pool;
+    // Constructors still running past the portfolio deadline keep to a pool of their own, so
+    // they take no workers from the search or the polish; it is joined on exit
+    std::unique_ptr<ThreadPool> constructorPool;
+    Solution s;
+    if (constructor == "portfolio") {
+        constructorPool = std::make_unique<ThreadPool>();
+        ConstructorPortfolio portfolio(data, *constructorPool);
+        portfolio.addDefaults(gen);
+        s = portfolio.run();
+        std::cout << "Portfolio winner: " << portfolio.winner() << " (" << s.totalCost << ")\n";
+    } else {
+        s = constructor == "split" ? SplitConstructor(data).solve()
+          : constructor == "sweep" ? Sweep(data, &pool).solve()
+          : ClarkeWright(data).solve();
+    }
+    s.optimizeRoutes(data, &routeCache, &pool);
+
+    // In fleet-limit mode, remove routes while the fleet cannot give each its own vehicle.
+    // Each run gets minimizerShare of the method's budget, or a second without one.
+    RouteMinimizer minimizer(data);
+    const double minimizerShare = 0.25;
+    auto limitFleet = [&](const char* stage, double methodMs) {
+        if (!fleetLimit || assignVehicles(data, s)) return;
+        double ms = methodMs > 0 ? minimizerShare * methodMs : 1000.0;
+        size_t before = s.routes.size();
+        bool reached = minimizer.run(s, Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                                           std::chrono::duration<double, std::milli>(ms)));
+        std::cout << "Route minimization " << stage << ": " << before << " -> " << s.routes.size() << " routes, "
+                  << minimizer.ejectionCountTotal() << " ejections, " << minimizer.elapsedMs() << " ms"
+                  << (reached ? "" : " (fleet still too small)") << "\n";
+    };
+    if (method == "versions") return checkRouteRecycling(data, s) ? 0 : 1;
+#ifdef VRP_COUNT_ALLOCATIONS
+    if (method == "allocs") return checkSteadyStateAllocations(data, s, gen) ? 0 : 1;
+#endif
+    double lowerBound = LowerBound(data).compute(s.totalCost);
 
-    if (!s.isValid(data)) std::cerr << "Invalid initial solution." << std::endl;
-    if (s.routes.size() > data.vehicles.size()) std::cerr << "More routes than vehicles." << std::endl;
+    // Improvement method: "anytime" (default), "sa", "lns", "alns", "hgs", "tabu" or "island".
+    // budgetMs is the method's wall-clock limit (0 when only iterations bound it); the
+    // final polish runs within the same budget.
+    Clock::time_point searchStart = Clock::now();
+    double budgetMs = 0.0;
+    // Take the method's time limit as the budget; route minimization before the search
+    // comes out of it, so the method keeps what is left
+    auto startSearch = [&](double& limitMs) {
+        budgetMs = limitMs;
+        limitFleet("before search", budgetMs);
+        double spent = std::chrono::duration<double, std::milli>(Clock::now() - searchStart).count();
+        if (limitMs > 0) limitMs = std::max(1.0, limitMs - spent);
+    };
+    if (method == "island") {
+#ifdef VRP_HAS_SOCKETS
+        int index = args.size() > 1 ? std::atoi(args[1].c_str()) : 0, count = args.size() > 2 ? std::atoi(args[2].c_str()) : 1;
+        if (count < 1 || index < 0 || index >= count) {
+            std::cerr << "Island index must be in [0, count), got " << index << " of " << count << std::endl;
+            return 1;
+        }
+        IslandModel island(data, gen, index, count);
+        if (args.size() > 3) island.basePort = std::atoi(args[3].c_str());
+        startSearch(island.timeLimitMs);
+        s = island.run(s);
+        std::cout << "Island " << index << ": " << island.migrantsSent() << " migrants sent, "
+                  << island.migrantsReceived() << " received, " << island.migrantsAccepted() << " accepted\n";
+        if (index > 0) csvFile = "routes_solution_island" + std::to_string(index) + ".csv";
+#else
+        std::cerr << "Island model needs POSIX sockets." << std::endl;
+#endif
+    } else if (method == "tabu") {
+        TabuSearch tabu(data, gen);
+        startSearch(tabu.timeLimitMs);
+        s = tabu.run(s);
+        std::cout << "Tabu search: " << tabu.iterationCount() << " iterations\n";
+    } else if (method == "hgs") {
+        HybridGeneticSearch hgs(data, gen);
+        startSearch(hgs.timeLimitMs);
+        s = hgs.run(s);
+        std::cout << "Hybrid genetic search: " << hgs.iterationCount() << " generations\n";
+    } else if (method == "alns") {
+        ParallelALNS alns(data, gen, pool);
+        startSearch(alns.timeLimitMs);
+        s = alns.run(s);
+        std::cout << "Parallel ALNS: " << alns.iterationCount() << " iterations (" << alns.iterationsPerSecond()
+                  << " per second), " << alns.publishShareRate() * 100.0 << "% of published routes shared\n";
+    } else if (method == "lns") {
+        LNS lns(data, gen);
+        startSearch(lns.timeLimitMs);
+        s = lns.run(s);
+        std::cout << "LNS: " << lns.iterationCount() << " iterations (" << lns.iterationsPerSecond() << " per second)\n";
+    } else if (method == "sa") {
+        SimulatedAnnealing sa(data, gen, &pool);
+        sa.replicas = replicas;
+        startSearch(sa.timeLimitMs);
+        s = sa.run(s);
+        std::cout << "Simulated annealing: " << sa.acceptedMoves() << " accepted moves, " << replicas << " replica(s)\n";
+    } else {
+        RoutePool routePool;
+        AnytimeSolver anytime(data, gen);
+        anytime.routePool = &routePool;
+        anytime.lowerBound = lowerBound;
+        startSearch(anytime.timeLimitMs);
+        s = anytime.run(s);
+        std::cout << "Anytime search: " << anytime.iterationCount() << " iterations, "
+                  << anytime.improvementTrace().size() << " improvements, last at "
+                  << anytime.improvementTrace().back().ms << " ms, " << routePool.size() << " pooled routes\n";
+    }
+    Clock::time_point deadline = budgetMs > 0 ? searchStart + std::chrono::duration_cast<Clock::duration>(
+                                                                 std::chrono::duration<double, std::milli>(budgetMs))
+                                              : Clock::time_point::max();
+    limitFleet("after search", budgetMs);
+    s.optimizeRoutes(data, &routeCache, &pool, deadline);
+    // Final routes may fit cheaper vehicles than the ones they were built on
+    if (!assignVehicles(data, s)) std::cerr << "Warning: the fleet cannot give every route its own vehicle" << std::endl;
+
+    SolutionValidator validator(data);
+    if (!validator.validate(s)) {
+        std::cerr << "Invalid solution: " << validator.count() << " violations." << std::endl;
+        validator.print(std::cerr);
+    }
 
-    std::cout << "\nTotal cost: " << s.totalCost << ", Routes: " << s.routes.size()  << std::endl;
+    std::cout << "\nTotal cost: " << s.totalCost << ", Routes: " << s.routes.size()
+              << ", Lower bound: " << lowerBound << ", Gap: " << (s.totalCost - lowerBound) / s.totalCost * 100.0 << "%" << std::endl;
+    std::cout << "Route cache hit rate: " << routeCache.hitRate() * 100.0 << "% ("
+              << routeCache.hits() << " hits, " << routeCache.misses() << " misses)\n";
     std::cout << data.depot.x << "," << data.depot.y << " (Depot)\n";
     for (size_t i = 0; i < s.routes.size(); ++i) {
         const auto& r = s.routes[i];
-        std::cout << "Route " << i+1 << " (Vehicle " << r.vehicleId << ", Customers: " << r.currentLoad << "): Depot -> ";
-        for (const auto& c : r.customers) std::cout << c.id << " -> ";
+        std::cout << "Route " << i+1 << " (Vehicle " << r.vehicleId << ", Load: " << r.currentLoad << "): Depot -> ";
+        for (NodeId c : r.customers) std::cout << c << " -> ";
         std::cout << "Depot (" << r.totalDistance << ")\n";
     }
+    printFleetUsage(data, s, std::cout);
 
-    exportSolutionToCSV(s, data, "routes_solution.csv");
+    exportSolutionToCSV(s, data, csvFile);
     return 0;
 }